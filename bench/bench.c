@@ -0,0 +1,367 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <rofi/helper.h>
+
+#include "../src/formatter.h"
+#include "../src/loader.h"
+#include "../src/search.h"
+#include "../src/utils.h"
+#include "dataset.h"
+#include "rofi-shim.h"
+
+/*
+ * Times the hot paths of the plugin outside of Rofi.
+ *
+ * Usage: rofi-emoji-bench [-time SECONDS] [-scale N]... [-synthetic N]...
+ *                         [rofi options] <emoji file>...
+ *
+ * Every benchmark is run for each emoji file, and for each file enlarged `N`
+ * times with `-scale N`. `-synthetic N` adds a made-up file of `N` emojis with
+ * realistic names and keywords. Results are printed as one JSON object per
+ * line:
+ *
+ *   {"benchmark": "search", "dataset": "all_emojis.txt", "rows": 3700,
+ *    "ops": 1600, "ns_per_op": 123456.7, "allocs_per_op": 42.00,
+ *    "peak_rss_kb": 12345}
+ *
+ * `allocs_per_op` is null when allocations cannot be counted on this platform.
+ * `peak_rss_kb` is the peak of the whole process so far, so it only grows from
+ * one line to the next. Options meant for the plugin, like `-emoji-format`,
+ * `-emoji-threads` or `-case-sensitive`, are passed on to it.
+ */
+
+// Searched by the search benchmarks, in order. Every query is matched against
+// the whole table, with a cold query cache.
+static const char *QUERIES[] = {
+    "smile",     "face",   "cat",        "heart",     "red heart",
+    "thumbs up", "flag",   "hand",       "-face",     "@animals",
+    "@food",     "#fruit", "skin tone",  "s",         "o",
+    "ki",        "grinning face with",   "zzz",       "@smileys -cat",
+    "#face-hand hand",
+};
+
+static const char *CUSTOM_FORMAT =
+    "{emoji} {name}[ ({group}/{subgroup})][ <i>{keywords}</i>] {codepoint}";
+
+static gint64 min_time_ns = 500 * G_GINT64_CONSTANT(1000000);
+
+#ifdef __GLIBC__
+// Every allocation made by the plugin ends up in malloc, including the ones
+// made through GLib, so wrapping glibc's allocator is enough to count them.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static guint64 allocations = 0;
+#define COUNTS_ALLOCATIONS TRUE
+
+void *malloc(size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+
+static guint64 allocation_count(void) {
+  return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+#else
+#define COUNTS_ALLOCATIONS FALSE
+
+static guint64 allocation_count(void) { return 0; }
+#endif
+
+static gint64 now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void print_json_string(const char *text) {
+  putchar('"');
+  for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      printf("\\%c", *c);
+    } else if (*c < 0x20) {
+      printf("\\u%04x", *c);
+    } else {
+      putchar(*c);
+    }
+  }
+  putchar('"');
+}
+
+typedef struct {
+  const char *name;
+  const char *path;
+  EmojiTable *table;
+} Dataset;
+
+typedef void (*BenchFunc)(Dataset *dataset);
+
+// Runs `func` until at least the minimum time has passed, and reports the
+// averages over the `ops_per_run` operations that every call performs.
+static void run_benchmark(const char *name, Dataset *dataset, BenchFunc func,
+                          guint64 ops_per_run) {
+  guint64 runs = 0;
+  guint64 allocations_before = allocation_count();
+  gint64 start = now_ns();
+  gint64 elapsed;
+
+  do {
+    func(dataset);
+    runs++;
+    elapsed = now_ns() - start;
+  } while (elapsed < min_time_ns);
+
+  guint64 allocated = allocation_count() - allocations_before;
+  guint64 ops = runs * ops_per_run;
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  printf("{\"benchmark\": ");
+  print_json_string(name);
+  printf(", \"dataset\": ");
+  print_json_string(dataset->name);
+  printf(", \"rows\": %u, \"ops\": %" G_GUINT64_FORMAT
+         ", \"ns_per_op\": %.1f, \"allocs_per_op\": ",
+         dataset->table->len, ops, (double)elapsed / ops);
+  if (COUNTS_ALLOCATIONS) {
+    printf("%.2f", (double)allocated / ops);
+  } else {
+    printf("null");
+  }
+  printf(", \"peak_rss_kb\": %ld}\n", usage.ru_maxrss);
+  fflush(stdout);
+}
+
+static void bench_read(Dataset *dataset) {
+  emoji_table_free(read_emojis_from_file(dataset->path, NULL));
+}
+
+static void bench_matcher_strings(Dataset *dataset) {
+  g_strfreev(generate_matcher_strings(dataset->table));
+}
+
+static void format_all(Dataset *dataset, const char *format) {
+  for (unsigned int i = 0; i < dataset->table->len; ++i) {
+    g_free(format_emoji(dataset->table, i, format));
+  }
+}
+
+static void bench_format_default(Dataset *dataset) {
+  format_all(dataset, DEFAULT_FORMAT);
+}
+
+static void bench_format_custom(Dataset *dataset) {
+  format_all(dataset, CUSTOM_FORMAT);
+}
+
+static void bench_tokenize(Dataset *dataset) {
+  for (int i = 0; i < G_N_ELEMENTS(QUERIES); ++i) {
+    char *query;
+    char *group_query;
+    char *subgroup_query;
+    tokenize_search(QUERIES[i], &query, &group_query, &subgroup_query);
+    g_free(query);
+    g_free(group_query);
+    g_free(subgroup_query);
+  }
+}
+
+static void init_search(EmojiModePrivateData *pd, Dataset *dataset) {
+  memset(pd, 0, sizeof(*pd));
+  pd->emojis = dataset->table;
+  pd->selected_emoji = NO_EMOJI;
+  pd->search_threads = 1;
+
+  char *format;
+  if (find_arg_str("-emoji-format", &format)) {
+    pd->format = format;
+  }
+  unsigned int threads;
+  if (find_arg_uint("-emoji-threads", &threads)) {
+    pd->search_threads = threads > 0 ? threads : g_get_num_processors();
+  }
+
+  emoji_search_init(pd);
+}
+
+static void bench_search_init(Dataset *dataset) {
+  EmojiModePrivateData pd;
+  init_search(&pd, dataset);
+  emoji_search_destroy(&pd);
+}
+
+// Set up by run_dataset, so that only searching is timed.
+static EmojiModePrivateData search_pd;
+
+// Does what Rofi does for every change of the input: preprocess it, tokenize
+// the result and then ask for every row whether it matches.
+static void bench_search(Dataset *dataset) {
+  int case_sensitive = find_arg("-case-sensitive") >= 0;
+  for (int i = 0; i < G_N_ELEMENTS(QUERIES); ++i) {
+    cache_clear(search_pd.query_cache);
+
+    char *input = emoji_search_preprocess_input(&search_pd, QUERIES[i]);
+    rofi_int_matcher **tokens = helper_tokenize(input, case_sensitive);
+    for (unsigned int row = 0; row < dataset->table->len; ++row) {
+      emoji_search_token_match(&search_pd, tokens, row);
+    }
+    helper_tokenize_free(tokens);
+    g_free(input);
+  }
+}
+
+// Writes `scale` copies of the emoji file at `path` into a temporary file, with
+// the copies told apart by a number after their name.
+static char *write_scaled_dataset(const char *path, unsigned int scale) {
+  char *contents;
+  if (!g_file_get_contents(path, &contents, NULL, NULL)) {
+    return NULL;
+  }
+
+  char *scaled_path;
+  int fd = g_file_open_tmp("rofi-emoji-bench-XXXXXX.txt", &scaled_path, NULL);
+  if (fd < 0) {
+    g_free(contents);
+    return NULL;
+  }
+
+  FILE *out = fdopen(fd, "w");
+  char **lines = g_strsplit(contents, "\n", -1);
+  for (unsigned int copy = 0; copy < scale; ++copy) {
+    for (int i = 0; lines[i] != NULL; ++i) {
+      char **fields = g_strsplit(lines[i], "\t", 5);
+      if (g_strv_length(fields) == 5) {
+        fprintf(out, "%s\t%s\t%s\t%s %u\t%s\n", fields[0], fields[1],
+                fields[2], fields[3], copy, fields[4]);
+      }
+      g_strfreev(fields);
+    }
+  }
+
+  fclose(out);
+  g_strfreev(lines);
+  g_free(contents);
+  return scaled_path;
+}
+
+static void run_dataset(const char *name, const char *path) {
+  EmojiTable *table = read_emojis_from_file(path, NULL);
+  if (table == NULL) {
+    fprintf(stderr, "Cannot read %s\n", path);
+    return;
+  }
+
+  Dataset dataset = {.name = name, .path = path, .table = table};
+  unsigned int rows = table->len;
+
+  run_benchmark("read_emojis_from_file", &dataset, bench_read, 1);
+  run_benchmark("generate_matcher_strings", &dataset, bench_matcher_strings,
+                1);
+  run_benchmark("format_emoji_default", &dataset, bench_format_default, rows);
+  run_benchmark("format_emoji_custom", &dataset, bench_format_custom, rows);
+  run_benchmark("tokenize_search", &dataset, bench_tokenize,
+                G_N_ELEMENTS(QUERIES));
+  run_benchmark("emoji_search_init", &dataset, bench_search_init, 1);
+
+  init_search(&search_pd, &dataset);
+  run_benchmark("search", &dataset, bench_search, G_N_ELEMENTS(QUERIES));
+  emoji_search_destroy(&search_pd);
+
+  emoji_table_free(table);
+}
+
+int main(int argc, char *argv[]) {
+  rofi_shim_set_arguments(argc, argv);
+
+  GArray *scales = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+  GArray *synthetic = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+  GPtrArray *paths = g_ptr_array_new();
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-time") == 0 && i + 1 < argc) {
+      min_time_ns = g_ascii_strtod(argv[++i], NULL) * 1e9;
+    } else if (strcmp(argv[i], "-scale") == 0 && i + 1 < argc) {
+      unsigned int scale = strtoul(argv[++i], NULL, 10);
+      if (scale > 1) {
+        g_array_append_val(scales, scale);
+      }
+    } else if (strcmp(argv[i], "-synthetic") == 0 && i + 1 < argc) {
+      unsigned int count = strtoul(argv[++i], NULL, 10);
+      g_array_append_val(synthetic, count);
+    } else if (strcmp(argv[i], "-emoji-format") == 0 ||
+               strcmp(argv[i], "-emoji-threads") == 0) {
+      // Read by the plugin itself.
+      i++;
+    } else if (argv[i][0] != '-') {
+      g_ptr_array_add(paths, argv[i]);
+    }
+  }
+
+  if (paths->len == 0 && synthetic->len == 0) {
+    fprintf(stderr,
+            "Usage: %s [-time SECONDS] [-scale N]... [-synthetic N]... "
+            "[rofi options] <emoji file>...\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (guint i = 0; i < paths->len; ++i) {
+    const char *path = g_ptr_array_index(paths, i);
+    char *name = g_path_get_basename(path);
+    run_dataset(name, path);
+
+    for (guint j = 0; j < scales->len; ++j) {
+      unsigned int scale = g_array_index(scales, unsigned int, j);
+      char *scaled_path = write_scaled_dataset(path, scale);
+      if (scaled_path == NULL) {
+        fprintf(stderr, "Cannot enlarge %s\n", path);
+        continue;
+      }
+
+      char *scaled_name = g_strdup_printf("%s x%u", name, scale);
+      run_dataset(scaled_name, scaled_path);
+      g_unlink(scaled_path);
+      g_free(scaled_name);
+      g_free(scaled_path);
+    }
+    g_free(name);
+  }
+
+  for (guint i = 0; i < synthetic->len; ++i) {
+    unsigned int count = g_array_index(synthetic, unsigned int, i);
+    char *path = write_synthetic_emoji_file(count, 1);
+    if (path == NULL) {
+      fprintf(stderr, "Cannot write %u synthetic emojis\n", count);
+      continue;
+    }
+
+    char *name = g_strdup_printf("synthetic %u", count);
+    run_dataset(name, path);
+    g_unlink(path);
+    g_free(name);
+    g_free(path);
+  }
+
+  g_array_free(scales, TRUE);
+  g_array_free(synthetic, TRUE);
+  g_ptr_array_free(paths, TRUE);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "dataset.h"
+
+// Made-up emoji files for measuring how the plugin scales past the bundled
+// emojis. They follow the format of all_emojis.txt and its shape:
+//
+// - Words are drawn from a fixed vocabulary with a Zipf-like distribution, so
+//   that a few words are very common and most are rare, like in real names
+//   and keywords.
+// - Most emojis have a handful of keywords, and a few have so many that their
+//   lines get long.
+// - Emojis are spread over 10 groups of 10 subgroups each.
+
+#define VOCABULARY_SIZE 4096
+#define GROUP_COUNT 10
+#define SUBGROUPS_PER_GROUP 10
+
+// One in LONG_LINE_ODDS emojis gets keywords until its line is about
+// LONG_LINE_LENGTH bytes long, which is longer than most line buffers.
+#define LONG_LINE_ODDS 100
+#define LONG_LINE_LENGTH 4096
+
+static const char *SYLLABLES[] = {
+    "ba", "be", "bo", "ca", "ci", "da", "de", "do", "fa", "fi", "ga", "go",
+    "ha", "hi", "ja", "ka", "ki", "la", "le", "li", "lo", "ma", "me", "mi",
+    "mo", "na", "ne", "no", "pa", "pe", "po", "ra", "re", "ri", "ro", "sa",
+    "se", "si", "so", "ta", "te", "ti", "to", "va", "ve", "wa", "ya", "zo",
+};
+
+static const char *GROUPS[GROUP_COUNT] = {
+    "Smileys & Emotion", "People & Body", "Animals & Nature", "Food & Drink",
+    "Travel & Places",   "Activities",    "Objects",          "Symbols",
+    "Flags",             "Component",
+};
+
+typedef struct {
+  GRand *rand;
+  char *words[VOCABULARY_SIZE];
+} Generator;
+
+static char *make_word(GRand *rand) {
+  GString *word = g_string_new("");
+  int syllables = g_rand_int_range(rand, 1, 5);
+  for (int i = 0; i < syllables; ++i) {
+    int syllable = g_rand_int_range(rand, 0, G_N_ELEMENTS(SYLLABLES));
+    g_string_append(word, SYLLABLES[syllable]);
+  }
+  return g_string_free(word, FALSE);
+}
+
+// Picks the word with rank r with a probability of about 1/r.
+static const char *pick_word(Generator *generator) {
+  double rank = pow(VOCABULARY_SIZE, g_rand_double(generator->rand));
+  return generator->words[MIN((int)rank - 1, VOCABULARY_SIZE - 1)];
+}
+
+static void append_emoji(GString *line, GRand *rand) {
+  char bytes[6];
+  int parts = g_rand_int_range(rand, 0, 20) == 0 ? 2 : 1;
+
+  for (int i = 0; i < parts; ++i) {
+    if (i > 0) {
+      g_string_append(line, "\xe2\x80\x8d"); // ZERO WIDTH JOINER
+    }
+    gunichar c = 0x1f300 + g_rand_int_range(rand, 0, 0x700);
+    g_string_append_len(line, bytes, g_unichar_to_utf8(c, bytes));
+    if (g_rand_int_range(rand, 0, 10) == 0) {
+      g_string_append(line, "\xef\xb8\x8f"); // VARIATION SELECTOR-16
+    }
+  }
+}
+
+static void append_line(GString *line, Generator *generator) {
+  GRand *rand = generator->rand;
+  int subgroup = g_rand_int_range(rand, 0, GROUP_COUNT * SUBGROUPS_PER_GROUP);
+
+  append_emoji(line, rand);
+  g_string_append_printf(line, "\t%s\tsubgroup-%d\t",
+                         GROUPS[subgroup / SUBGROUPS_PER_GROUP], subgroup);
+
+  int name_words = g_rand_int_range(rand, 1, 6);
+  for (int i = 0; i < name_words; ++i) {
+    if (i > 0) {
+      g_string_append_c(line, ' ');
+    }
+    g_string_append(line, pick_word(generator));
+  }
+  g_string_append_c(line, '\t');
+
+  gboolean long_line = g_rand_int_range(rand, 0, LONG_LINE_ODDS) == 0;
+  int keywords = g_rand_int_range(rand, 2, 13);
+  for (int i = 0; long_line ? line->len < LONG_LINE_LENGTH : i < keywords;
+       ++i) {
+    if (i > 0) {
+      g_string_append(line, " | ");
+    }
+    g_string_append(line, pick_word(generator));
+  }
+  g_string_append_c(line, '\n');
+}
+
+/*
+ * Writes `count` made-up emojis in the format of all_emojis.txt to `out`. The
+ * same seed always gives the same emojis.
+ */
+void write_synthetic_emojis(FILE *out, unsigned int count, guint32 seed) {
+  Generator generator;
+  generator.rand = g_rand_new_with_seed(seed);
+  for (int i = 0; i < VOCABULARY_SIZE; ++i) {
+    generator.words[i] = make_word(generator.rand);
+  }
+
+  GString *line = g_string_sized_new(LONG_LINE_LENGTH + 64);
+  for (unsigned int i = 0; i < count; ++i) {
+    g_string_truncate(line, 0);
+    append_line(line, &generator);
+    fwrite(line->str, 1, line->len, out);
+  }
+
+  g_string_free(line, TRUE);
+  for (int i = 0; i < VOCABULARY_SIZE; ++i) {
+    g_free(generator.words[i]);
+  }
+  g_rand_free(generator.rand);
+}
+
+/*
+ * Writes `count` made-up emojis to a new temporary file and returns its path,
+ * or NULL if the file could not be written. Remove the file and free the path
+ * when done.
+ */
+char *write_synthetic_emoji_file(unsigned int count, guint32 seed) {
+  char *path;
+  int fd = g_file_open_tmp("rofi-emoji-XXXXXX.txt", &path, NULL);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  FILE *out = fdopen(fd, "w");
+  write_synthetic_emojis(out, count, seed);
+  if (fclose(out) != 0) {
+    g_unlink(path);
+    g_free(path);
+    return NULL;
+  }
+  return path;
+}
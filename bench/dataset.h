@@ -0,0 +1,10 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <glib.h>
+#include <stdio.h>
+
+void write_synthetic_emojis(FILE *out, unsigned int count, guint32 seed);
+char *write_synthetic_emoji_file(unsigned int count, guint32 seed);
+
+#endif // DATASET_H
@@ -0,0 +1,33 @@
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dataset.h"
+
+/*
+ * Writes a made-up emoji file for testing with large datasets.
+ *
+ * Usage: rofi-emoji-generate <count> <emoji file> [seed]
+ */
+int main(int argc, char *argv[]) {
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr, "Usage: %s <count> <emoji file> [seed]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  unsigned int count = strtoul(argv[1], NULL, 10);
+  guint32 seed = argc == 4 ? strtoul(argv[3], NULL, 10) : 1;
+
+  FILE *out = fopen(argv[2], "w");
+  if (out == NULL) {
+    fprintf(stderr, "%s: Cannot write %s\n", argv[0], argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  write_synthetic_emojis(out, count, seed);
+  if (fclose(out) != 0) {
+    fprintf(stderr, "%s: Cannot write %s\n", argv[0], argv[2]);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+#include <glib.h>
+#include <gmodule.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Must be included before other rofi includes.
+#include <rofi/mode.h>
+
+#include <rofi/helper.h>
+#include <rofi/mode-private.h>
+
+#include "rofi-shim.h"
+
+/*
+ * Loads the plugin like Rofi does and replays typing sessions against it, to
+ * measure the latency of every keystroke without a display.
+ *
+ * Usage: rofi-emoji-host [-trace] [-select] [-lines N] [rofi options]
+ *                        <plugin> <session file>...
+ *
+ * Every non-empty line of a session file that does not start with `#` is one
+ * session: the mode is initialized, the line is typed one character at a time
+ * and the mode is destroyed again. `\b` in a line is a backspace.
+ *
+ * After each keystroke, the host does what Rofi does on input changes:
+ * preprocess the input, tokenize it, match every row, and render the message
+ * and the first `-lines` (default 15) matching rows. A session ends by
+ * accepting the first match with `-select`, and by cancelling otherwise.
+ *
+ * Latency percentiles are printed as one JSON object per measurement. With
+ * `-trace`, every keystroke is printed as well, along with the number of
+ * matches and the first rendered row, which makes the output usable for
+ * comparing behavior between versions.
+ */
+
+typedef struct {
+  GArray *startup;
+  GArray *keystrokes;
+} Latencies;
+
+static gboolean trace = FALSE;
+static gboolean select_match = FALSE;
+static unsigned int visible_lines = 15;
+
+// Options taking a value, which is not a plugin or session file then.
+static const char *VALUE_OPTIONS[] = {
+    "-lines",      "-emoji-file",    "-emoji-format",
+    "-emoji-mode", "-emoji-threads", NULL,
+};
+
+static double elapsed_us(gint64 start) {
+  return (double)(g_get_monotonic_time() - start);
+}
+
+static void print_json_string(const char *text) {
+  putchar('"');
+  for (const unsigned char *c = (const unsigned char *)text;
+       c != NULL && *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      printf("\\%c", *c);
+    } else if (*c < 0x20) {
+      printf("\\u%04x", *c);
+    } else {
+      putchar(*c);
+    }
+  }
+  putchar('"');
+}
+
+// Like Rofi, smart case makes any uppercase character in the input switch to
+// case sensitive matching.
+static int is_case_sensitive(const char *input) {
+  if (find_arg("-case-sensitive") >= 0) {
+    return TRUE;
+  }
+  if (find_arg("-case-smart") < 0 || !g_utf8_validate(input, -1, NULL)) {
+    return FALSE;
+  }
+
+  for (const char *c = input; *c != '\0'; c = g_utf8_next_char(c)) {
+    if (g_unichar_isupper(g_utf8_get_char(c))) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+// Filters and renders the rows for `input`. Returns the matching rows.
+static GArray *refilter(Mode *mode, const char *input) {
+  GArray *matches = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+  char *pattern = mode->_preprocess_input != NULL
+                      ? mode->_preprocess_input(mode, input)
+                      : g_strdup(input);
+  rofi_int_matcher **tokens =
+      helper_tokenize(pattern, is_case_sensitive(input));
+
+  unsigned int rows = mode->_get_num_entries(mode);
+  for (unsigned int row = 0; row < rows; ++row) {
+    if (tokens == NULL || mode->_token_match(mode, tokens, row)) {
+      g_array_append_val(matches, row);
+    }
+  }
+
+  g_free(mode->_get_message(mode));
+  for (unsigned int i = 0; i < MIN(matches->len, visible_lines); ++i) {
+    int state = 0;
+    GList *attributes = NULL;
+    g_free(mode->_get_display_value(
+        mode, g_array_index(matches, unsigned int, i), &state, &attributes,
+        TRUE));
+    g_list_free(attributes);
+  }
+
+  helper_tokenize_free(tokens);
+  g_free(pattern);
+  return matches;
+}
+
+static void trace_keystroke(Mode *mode, const char *input, GArray *matches,
+                            double latency) {
+  char *first = NULL;
+  if (matches->len > 0) {
+    int state = 0;
+    GList *attributes = NULL;
+    unsigned int row = g_array_index(matches, unsigned int, 0);
+    first = mode->_get_display_value(mode, row, &state, &attributes, TRUE);
+    g_list_free(attributes);
+  }
+
+  printf("{\"input\": ");
+  print_json_string(input);
+  printf(", \"matches\": %u, \"first\": ", matches->len);
+  if (first != NULL) {
+    print_json_string(first);
+  } else {
+    printf("null");
+  }
+  printf(", \"us\": %.1f}\n", latency);
+  g_free(first);
+}
+
+static gboolean replay_session(Mode *mode, const char *session,
+                               Latencies *latencies) {
+  gint64 start = g_get_monotonic_time();
+  if (!mode->_init(mode)) {
+    fprintf(stderr, "Cannot initialize the plugin\n");
+    return FALSE;
+  }
+  double startup = elapsed_us(start);
+  g_array_append_val(latencies->startup, startup);
+
+  GString *input = g_string_new("");
+  GArray *matches = NULL;
+
+  for (const char *c = session; *c != '\0';) {
+    if (c[0] == '\\' && c[1] == 'b') {
+      if (input->len > 0) {
+        const char *last = g_utf8_find_prev_char(input->str,
+                                                 input->str + input->len);
+        g_string_truncate(input, last != NULL ? last - input->str : 0);
+      }
+      c += 2;
+    } else {
+      const char *next = g_utf8_find_next_char(c, NULL);
+      g_string_append_len(input, c, next - c);
+      c = next;
+    }
+
+    if (matches != NULL) {
+      g_array_free(matches, TRUE);
+    }
+    start = g_get_monotonic_time();
+    matches = refilter(mode, input->str);
+    double latency = elapsed_us(start);
+    g_array_append_val(latencies->keystrokes, latency);
+
+    if (trace) {
+      trace_keystroke(mode, input->str, matches, latency);
+    }
+  }
+
+  char *text = g_string_free(input, FALSE);
+  if (select_match && matches != NULL && matches->len > 0) {
+    unsigned int row = g_array_index(matches, unsigned int, 0);
+    mode->_result(mode, MENU_OK, &text, row);
+    if (trace) {
+      printf("{\"input\": ");
+      print_json_string(text);
+      printf(", \"output\": ");
+      print_json_string(rofi_shim_last_output());
+      printf("}\n");
+    }
+  } else {
+    mode->_result(mode, MENU_CANCEL, &text, 0);
+  }
+
+  if (matches != NULL) {
+    g_array_free(matches, TRUE);
+  }
+  g_free(text);
+  mode->_destroy(mode);
+  return TRUE;
+}
+
+static int compare_doubles(gconstpointer a, gconstpointer b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of the sorted `values`.
+static double percentile(GArray *values, double p) {
+  unsigned int rank = ceil(p / 100 * values->len);
+  return g_array_index(values, double, rank > 0 ? rank - 1 : 0);
+}
+
+static void print_latencies(const char *name, GArray *values) {
+  if (values->len == 0) {
+    return;
+  }
+  g_array_sort(values, compare_doubles);
+
+  printf("{\"benchmark\": ");
+  print_json_string(name);
+  printf(", \"count\": %u, \"p50_us\": %.1f, \"p90_us\": %.1f, "
+         "\"p99_us\": %.1f, \"max_us\": %.1f}\n",
+         values->len, percentile(values, 50), percentile(values, 90),
+         percentile(values, 99),
+         g_array_index(values, double, values->len - 1));
+}
+
+static gboolean is_value_option(const char *arg) {
+  for (int i = 0; VALUE_OPTIONS[i] != NULL; ++i) {
+    if (strcmp(arg, VALUE_OPTIONS[i]) == 0) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+int main(int argc, char *argv[]) {
+  rofi_shim_set_arguments(argc, argv);
+
+  GPtrArray *files = g_ptr_array_new();
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-trace") == 0) {
+      trace = TRUE;
+    } else if (strcmp(argv[i], "-select") == 0) {
+      select_match = TRUE;
+    } else if (strcmp(argv[i], "-lines") == 0 && i + 1 < argc) {
+      visible_lines = strtoul(argv[++i], NULL, 10);
+    } else if (is_value_option(argv[i])) {
+      // Read by the plugin itself.
+      i++;
+    } else if (argv[i][0] != '-') {
+      g_ptr_array_add(files, argv[i]);
+    }
+  }
+
+  if (files->len < 2) {
+    fprintf(stderr,
+            "Usage: %s [-trace] [-select] [-lines N] [rofi options] "
+            "<plugin> <session file>...\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  GModule *module = g_module_open(g_ptr_array_index(files, 0),
+                                  G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+  if (module == NULL) {
+    fprintf(stderr, "Cannot load the plugin: %s\n", g_module_error());
+    return EXIT_FAILURE;
+  }
+
+  Mode *mode;
+  if (!g_module_symbol(module, "mode", (gpointer *)&mode) ||
+      mode->abi_version != ABI_VERSION) {
+    fprintf(stderr, "%s is not a Rofi plugin of ABI version %u\n",
+            (char *)g_ptr_array_index(files, 0), ABI_VERSION);
+    return EXIT_FAILURE;
+  }
+
+  Latencies latencies = {
+      .startup = g_array_new(FALSE, FALSE, sizeof(double)),
+      .keystrokes = g_array_new(FALSE, FALSE, sizeof(double)),
+  };
+  int status = EXIT_SUCCESS;
+
+  for (guint i = 1; i < files->len && status == EXIT_SUCCESS; ++i) {
+    char *contents;
+    GError *error = NULL;
+    if (!g_file_get_contents(g_ptr_array_index(files, i), &contents, NULL,
+                             &error)) {
+      fprintf(stderr, "%s\n", error->message);
+      g_error_free(error);
+      status = EXIT_FAILURE;
+      break;
+    }
+
+    char **sessions = g_strsplit(contents, "\n", -1);
+    for (int j = 0; sessions[j] != NULL; ++j) {
+      if (sessions[j][0] == '\0' || sessions[j][0] == '#') {
+        continue;
+      }
+      if (!replay_session(mode, sessions[j], &latencies)) {
+        status = EXIT_FAILURE;
+        break;
+      }
+    }
+    g_strfreev(sessions);
+    g_free(contents);
+  }
+
+  if (status == EXIT_SUCCESS) {
+    print_latencies("startup", latencies.startup);
+    print_latencies("keystroke", latencies.keystrokes);
+  }
+
+  g_array_free(latencies.startup, TRUE);
+  g_array_free(latencies.keystrokes, TRUE);
+  g_ptr_array_free(files, TRUE);
+  g_module_close(module);
+  return status;
+}
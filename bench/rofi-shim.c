@@ -0,0 +1,123 @@
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Must be included before other rofi includes.
+#include <rofi/mode.h>
+
+#include <rofi/helper.h>
+#include <rofi/mode-private.h>
+
+#include "rofi-shim.h"
+
+// The plugin is normally loaded into Rofi, which provides the helpers below.
+// The benchmarks and the search tests run without Rofi, so these reimplement
+// them the way Rofi does with its default (normal) matching method, to keep the
+// costs comparable.
+
+static int shim_argc = 0;
+static char **shim_argv = NULL;
+static char *last_output = NULL;
+
+void rofi_shim_set_arguments(int argc, char **argv) {
+  shim_argc = argc;
+  shim_argv = argv;
+}
+
+static rofi_int_matcher *create_matcher(const char *token,
+                                        int case_sensitive) {
+  rofi_int_matcher *matcher = g_malloc0(sizeof(rofi_int_matcher));
+  if (token[0] == '-') {
+    matcher->invert = TRUE;
+    token++;
+  }
+
+  char *pattern = g_regex_escape_string(token, -1);
+  matcher->regex = g_regex_new(
+      pattern, G_REGEX_OPTIMIZE | (case_sensitive ? 0 : G_REGEX_CASELESS), 0,
+      NULL);
+  g_free(pattern);
+  return matcher;
+}
+
+rofi_int_matcher **helper_tokenize(const char *input, int case_sensitive) {
+  if (input == NULL || input[0] == '\0') {
+    return NULL;
+  }
+
+  char *copy = g_strdup(input);
+  rofi_int_matcher **tokens = NULL;
+  int count = 0;
+  char *saveptr = NULL;
+
+  for (char *token = strtok_r(copy, " ", &saveptr); token != NULL;
+       token = strtok_r(NULL, " ", &saveptr)) {
+    tokens = g_realloc(tokens, sizeof(rofi_int_matcher *) * (count + 2));
+    tokens[count++] = create_matcher(token, case_sensitive);
+    tokens[count] = NULL;
+  }
+
+  g_free(copy);
+  return tokens;
+}
+
+void helper_tokenize_free(rofi_int_matcher **tokens) {
+  for (int i = 0; tokens != NULL && tokens[i] != NULL; ++i) {
+    g_regex_unref(tokens[i]->regex);
+    g_free(tokens[i]);
+  }
+  g_free(tokens);
+}
+
+int helper_token_match(rofi_int_matcher *const *tokens, const char *input) {
+  int match = TRUE;
+  for (int i = 0; match && tokens != NULL && tokens[i] != NULL; ++i) {
+    match = g_regex_match(tokens[i]->regex, input, 0, NULL);
+    match ^= tokens[i]->invert;
+  }
+  return match;
+}
+
+int find_arg(const char *const key) {
+  for (int i = 0; i < shim_argc; ++i) {
+    if (strcmp(shim_argv[i], key) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int find_arg_str(const char *const key, char **val) {
+  int i = find_arg(key);
+  if (i >= 0 && i + 1 < shim_argc) {
+    *val = shim_argv[i + 1];
+    return TRUE;
+  }
+  return FALSE;
+}
+
+int find_arg_uint(const char *const key, unsigned int *val) {
+  int i = find_arg(key);
+  if (i >= 0 && i + 1 < shim_argc) {
+    *val = strtoul(shim_argv[i + 1], NULL, 10);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+void *mode_get_private_data(const Mode *mode) { return mode->private_data; }
+
+void mode_set_private_data(Mode *mode, void *pd) { mode->private_data = pd; }
+
+// There is no window to hide.
+void rofi_view_hide(void) {}
+
+// Remembers the output instead of printing it, so that it does not get mixed
+// up with the results.
+void rofi_output_formatted_line(const char *format, const char *string,
+                                int selected_line, const char *filter) {
+  g_free(last_output);
+  last_output = g_strdup(string);
+}
+
+const char *rofi_shim_last_output(void) { return last_output; }
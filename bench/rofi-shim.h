@@ -0,0 +1,12 @@
+#ifndef ROFI_SHIM_H
+#define ROFI_SHIM_H
+
+// Makes `find_arg` and friends look at these arguments, like Rofi looks at its
+// own command line.
+void rofi_shim_set_arguments(int argc, char **argv);
+
+// Returns the last line the plugin printed with `rofi_output_formatted_line`,
+// or NULL if it printed nothing yet.
+const char *rofi_shim_last_output(void);
+
+#endif // ROFI_SHIM_H
@@ -12,8 +12,21 @@ Usage:
     Try to write "the text" to the focused window. Will also copy the text in
     case insertion fails.
 
+  clipboard-adapter.sh serve
+    Keep running and perform every request read from stdin, until stdin is
+    closed. A request is a line with the command (copy, insert or
+    insert_no_copy) and the number of lines of the text, followed by the text
+    and a newline. The exit status of every request is written to stdout on a
+    line of its own. Tools are only looked for once, when starting.
+
+  clipboard-adapter.sh --detect
+    Look for the tools again, even if they were found before, and show which
+    ones are used.
+
 Detects Wayland and X and finds the appropriate tool for the current
-environment.
+environment. The tools that were found are remembered in
+\$XDG_RUNTIME_DIR/rofi-emoji/ until the session or PATH changes, or one of
+them is gone.
 
 When rofi is run from a terminal, the output both on stderr and stdout should
 be visible to the user and makes it possible to do some debugging.
@@ -32,7 +45,11 @@ main() {
       command=help
       break
       ;;
-    copy | insert | insert_no_copy | help)
+    --detect)
+      shift
+      command=detect
+      ;;
+    copy | insert | insert_no_copy | serve | help)
       command="$1"
       shift
       ;;
@@ -52,6 +69,26 @@ main() {
     usage
     exit 0
     ;;
+  copy | insert | insert_no_copy)
+    find_tools
+    perform "$command"
+    ;;
+  serve)
+    find_tools
+    serve
+    ;;
+  detect)
+    detect
+    ;;
+  *)
+    usage >&2
+    exit 1
+    ;;
+  esac
+}
+
+perform() {
+  case "$1" in
   copy)
     perform_copy
     ;;
@@ -70,27 +107,68 @@ main() {
     # Same as 'insert' but without the copying fallback.
     perform_insert
     ;;
-  *)
-    usage >&2
-    exit 1
-    ;;
   esac
 }
 
+serve() {
+  # Responses go to fd 3, so that nothing the tools print can be mistaken for
+  # one.
+  exec 3>&1 1>&2
+
+  while IFS=' ' read -r request lines; do
+    case "$lines" in
+    "" | 0 | *[!0-9]*)
+      show_error "Invalid request: $request $lines"
+      exit 1
+      ;;
+    esac
+
+    # Only builtins, so that reading a request starts no processes.
+    IFS= read -r text
+    while [ "$lines" -gt 1 ] && IFS= read -r line; do
+      text="$text
+$line"
+      lines=$((lines - 1))
+    done
+
+    case "$request" in
+    copy | insert | insert_no_copy)
+      printf "%s" "$text" | perform "$request" 3>&-
+      status=$?
+      ;;
+    *)
+      show_error "Unknown request: $request"
+      status=1
+      ;;
+    esac
+    echo "$status" >&3
+  done
+}
+
 stderr_is_null() {
   test /proc/self/fd/2 -ef /dev/null
 }
 
+# rofi sends errors to a log file when it does not wait for the adapter.
+stderr_is_file() {
+  test -f /proc/self/fd/2
+}
+
 show_error() {
-  if stderr_is_null && hash notify-send 2>/dev/null; then
-    notify-send rofi-emoji "$@"
+  if stderr_is_file; then
+    echo "$(date '+%Y-%m-%d %H:%M:%S') $*" >&2
   else
     echo "$@" >&2
   fi
+
+  # Nobody is looking at either of those as it happens.
+  if { stderr_is_null || stderr_is_file; } && hash notify-send 2>/dev/null; then
+    notify-send rofi-emoji "$@"
+  fi
 }
 
 perform_copy() {
-  tool=$(find_copy_tool)
+  tool=$copy_tool
 
   case "$tool" in
   xsel)
@@ -117,7 +195,7 @@ perform_copy() {
 }
 
 perform_insert() {
-  tool=$(find_insert_tool)
+  tool=$insert_tool
 
   case "$tool" in
   xdotool)
@@ -137,6 +215,83 @@ perform_insert() {
   esac
 }
 
+# Set tools_cache to where the tools are remembered, if anywhere, and
+# cache_key to everything that decides which tools are found, other than the
+# tools themselves.
+locate_tools_cache() {
+  tools_cache=${XDG_RUNTIME_DIR:+$XDG_RUNTIME_DIR/rofi-emoji/tools}
+  cache_key="$XDG_SESSION_TYPE:$WAYLAND_DISPLAY:$DISPLAY:$PATH"
+}
+
+# Set copy_tool and insert_tool to the tools found the last time in the same
+# environment, if they are still installed, and look for the others. Reading
+# the cache only takes builtins, so no process is started when it is used.
+find_tools() {
+  locate_tools_cache
+  cached_key=
+  copy_tool=
+  insert_tool=
+  if [ -n "$tools_cache" ] && [ -f "$tools_cache" ]; then
+    {
+      IFS= read -r cached_key
+      IFS= read -r copy_tool
+      IFS= read -r insert_tool
+    } <"$tools_cache"
+  fi
+
+  if [ "$cached_key" != "$cache_key" ]; then
+    copy_tool=
+    insert_tool=
+  fi
+
+  found=
+  if [ -z "$copy_tool" ] || ! hash "$copy_tool" 2>/dev/null; then
+    copy_tool=$(find_copy_tool)
+    found=yes
+  fi
+  if [ -z "$insert_tool" ] || ! hash "$insert_tool" 2>/dev/null; then
+    insert_tool=$(find_insert_tool)
+    found=yes
+  fi
+
+  if [ -n "$found" ] && [ -n "$tools_cache" ]; then
+    save_tools
+  fi
+}
+
+save_tools() {
+  # Replaced in one go, so that other adapters never read half of it.
+  mkdir -p -m 700 "${tools_cache%/*}" 2>/dev/null &&
+    printf '%s\n' "$cache_key" "$copy_tool" "$insert_tool" \
+      >"$tools_cache.$$" 2>/dev/null &&
+    mv -f "$tools_cache.$$" "$tools_cache"
+}
+
+# Look for the tools again and show what was found, for debugging.
+detect() {
+  locate_tools_cache
+  copy_tool=$(find_copy_tool)
+  insert_tool=$(find_insert_tool)
+
+  if [ "$XDG_SESSION_TYPE" = wayland ] || [ -n "$WAYLAND_DISPLAY" ]; then
+    echo "Session: Wayland"
+  else
+    echo "Session: X"
+  fi
+  echo "Copy tool: ${copy_tool:-none}"
+  echo "Insert tool: ${insert_tool:-none}"
+
+  if [ -z "$tools_cache" ]; then
+    echo "Cache: none, XDG_RUNTIME_DIR is not set"
+  elif save_tools; then
+    echo "Cache: $tools_cache"
+  else
+    echo "Cache: cannot write $tools_cache"
+  fi
+
+  [ -n "$copy_tool" ] && [ -n "$insert_tool" ]
+}
+
 # Print out the first argument and return true if that argument is an installed
 # command. Prints nothing and returns false if the argument is not an installed
 # command.
@@ -1,24 +1,59 @@
 #include "actions.h"
 #include "menu.h"
+#include "search.h"
+#include "usage.h"
 #include "utils.h"
 
 #include <stdbool.h>
 
-Emoji *get_selected_emoji(EmojiModePrivateData *pd, unsigned int line) {
-  if (pd->selected_emoji != NULL) {
+unsigned int get_selected_emoji(EmojiModePrivateData *pd, unsigned int line) {
+  if (pd->selected_emoji != NO_EMOJI) {
     return pd->selected_emoji;
   }
 
   if (line >= pd->emojis->len) {
-    return NULL;
+    return NO_EMOJI;
   }
 
-  return g_ptr_array_index(pd->emojis, line);
+  return emoji_search_row(pd, line);
+}
+
+// Runs the clipboard adapter without waiting for it, so that rofi can exit
+// right away. Once rofi is gone, the adapter can only report errors in the
+// log file and as notifications.
+static int run_clipboard_adapter_detached(const char *action, const char *text,
+                                          char **error) {
+  char *adapter;
+  if (!find_clipboard_adapter(&adapter, error)) {
+    return FALSE;
+  }
+
+  char *log_path = clipboard_adapter_log_path();
+  int success =
+      clipboard_adapter_run_detached(adapter, action, text, log_path, error);
+  g_free(log_path);
+  g_free(adapter);
+  return success;
 }
 
 ModeMode text_adapter_action(const char *action, EmojiModePrivateData *pd,
-                             const char *text) {
-  if (run_clipboard_adapter(action, text, &(pd->message))) {
+                             const char *text, bool wait) {
+  // Replaces any earlier message, like lines skipped in the emoji file.
+  g_free(pd->message);
+  pd->message = NULL;
+
+  int success;
+  if (pd->clipboard_adapter != NULL) {
+    success = wait ? clipboard_adapter_run(pd->clipboard_adapter, action, text,
+                                           &(pd->message))
+                   : clipboard_adapter_send(pd->clipboard_adapter, action,
+                                            text, &(pd->message));
+  } else {
+    success = wait ? run_clipboard_adapter(action, text, &(pd->message))
+                   : run_clipboard_adapter_detached(action, text,
+                                                    &(pd->message));
+  }
+  if (success) {
     return MODE_EXIT;
   } else {
     // Copying failed, reload dialog to show error message in pd->message.
@@ -26,18 +61,41 @@ ModeMode text_adapter_action(const char *action, EmojiModePrivateData *pd,
   }
 }
 
+// Records that the emoji in `row` was used, so that it is listed earlier the
+// next time. Only called once the action succeeded.
+static void record_usage(EmojiModePrivateData *pd, unsigned int row) {
+  char *path = usage_log_path();
+  char *error = NULL;
+  if (!usage_log_append(path, pd->emoji_file, pd->emojis, row,
+                        g_get_real_time() / G_USEC_PER_SEC, &error)) {
+    g_warning("%s", error);
+    g_free(error);
+  }
+  g_free(path);
+}
+
+// Copies `text`, which belongs to the emoji in `row`.
+static ModeMode copy_text(EmojiModePrivateData *pd, unsigned int row,
+                          const char *text) {
+  ModeMode mode = text_adapter_action("copy", pd, text, pd->wait_for_copy);
+  if (mode == MODE_EXIT) {
+    record_usage(pd, row);
+  }
+  return mode;
+}
+
 ModeMode copy_emoji(EmojiModePrivateData *pd, unsigned int line) {
-  const Emoji *emoji = get_selected_emoji(pd, line);
-  if (emoji == NULL) {
+  unsigned int row = get_selected_emoji(pd, line);
+  if (row == NO_EMOJI) {
     return MODE_EXIT;
   }
 
-  return text_adapter_action("copy", pd, emoji->bytes);
+  return copy_text(pd, row, emoji_table_bytes(pd->emojis, row));
 }
 
 ModeMode insert_emoji(EmojiModePrivateData *pd, unsigned int line, bool copy) {
-  const Emoji *emoji = get_selected_emoji(pd, line);
-  if (emoji == NULL) {
+  unsigned int row = get_selected_emoji(pd, line);
+  if (row == NO_EMOJI) {
     return MODE_EXIT;
   }
 
@@ -45,42 +103,50 @@ ModeMode insert_emoji(EmojiModePrivateData *pd, unsigned int line, bool copy) {
   // insert action.
   rofi_view_hide();
   const char *action = copy ? "insert" : "insert_no_copy";
-  text_adapter_action(action, pd, emoji->bytes);
+  if (text_adapter_action(action, pd, emoji_table_bytes(pd->emojis, row),
+                          false) == MODE_EXIT) {
+    record_usage(pd, row);
+  }
 
-  // View is hidden and we cannot get it back again. We must exit at this point.
+  // View is hidden and we cannot get it back again. We must exit at this point,
+  // without waiting for the adapter to type the emoji.
   return MODE_EXIT;
 }
 
 ModeMode output_emoji(EmojiModePrivateData *pd, unsigned int line) {
-  const Emoji *emoji = get_selected_emoji(pd, line);
-  if (emoji == NULL) {
+  unsigned int row = get_selected_emoji(pd, line);
+  if (row == NO_EMOJI) {
     return MODE_EXIT;
   }
 
-  // Reuse Rofi's dmenu format settings and semantics.
+  // Reuse Rofi's dmenu format settings and semantics. The index is the one of
+  // the emoji in the emoji file, not the line it is listed on, which changes
+  // as emojis are used.
   char *format = "s";
   find_arg_str("-format", &format);
-  rofi_output_formatted_line(format, emoji->bytes, line, "");
+  rofi_output_formatted_line(format, emoji_table_bytes(pd->emojis, row), row,
+                             "");
+  record_usage(pd, row);
 
   return MODE_EXIT;
 }
 
 ModeMode copy_codepoint(EmojiModePrivateData *pd, unsigned int line) {
-  const Emoji *emoji = get_selected_emoji(pd, line);
-  if (emoji == NULL) {
+  unsigned int row = get_selected_emoji(pd, line);
+  if (row == NO_EMOJI) {
     return MODE_EXIT;
   }
 
-  return text_adapter_action("copy", pd, codepoint(emoji->bytes));
+  return copy_text(pd, row, codepoint(emoji_table_bytes(pd->emojis, row)));
 }
 
 ModeMode copy_name(EmojiModePrivateData *pd, unsigned int line) {
-  const Emoji *emoji = get_selected_emoji(pd, line);
-  if (emoji == NULL) {
+  unsigned int row = get_selected_emoji(pd, line);
+  if (row == NO_EMOJI) {
     return MODE_EXIT;
   }
 
-  return text_adapter_action("copy", pd, emoji->name);
+  return copy_text(pd, row, emoji_table_name(pd->emojis, row));
 }
 
 ModeMode open_menu(EmojiModePrivateData *pd, unsigned int line) {
@@ -88,12 +154,7 @@ ModeMode open_menu(EmojiModePrivateData *pd, unsigned int line) {
     return MODE_EXIT;
   }
 
-  Emoji *emoji = g_ptr_array_index(pd->emojis, line);
-  if (emoji == NULL) {
-    return MODE_EXIT;
-  }
-
-  pd->selected_emoji = emoji;
+  pd->selected_emoji = emoji_search_row(pd, line);
   emoji_menu_init(pd);
 
   return RESET_DIALOG;
@@ -101,7 +162,7 @@ ModeMode open_menu(EmojiModePrivateData *pd, unsigned int line) {
 
 ModeMode exit_menu(EmojiModePrivateData *pd, unsigned int line) {
   emoji_menu_destroy(pd);
-  pd->selected_emoji = NULL;
+  pd->selected_emoji = NO_EMOJI;
   return RESET_DIALOG;
 }
 
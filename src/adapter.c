@@ -0,0 +1,287 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adapter.h"
+
+// Running `clipboard-adapter.sh` for every copy or insert starts a new shell,
+// which then looks for the clipboard tools all over again. Started as
+// `clipboard-adapter.sh serve`, the adapter looks for them once and then
+// handles requests on its standard input until it is closed. Every request is
+//
+//   <action> <number of lines of the text>\n<text>\n
+//
+// so that the shell can read it with `read` alone, and is answered with the
+// exit status of the action on a line of its own.
+
+// How long an adapter without unanswered requests gets to exit before it is
+// killed, in milliseconds. It might be stuck looking for the clipboard tools,
+// or in one that hangs, and rofi must not hang on exit with it.
+#define STOP_TIMEOUT 100
+
+struct ClipboardAdapter {
+  GPid pid;
+  // The standard input and output of the adapter.
+  int requests;
+  FILE *responses;
+  // Requests that were sent without waiting for their response.
+  unsigned int unanswered;
+};
+
+// Opens the log file that the adapter's errors are appended to, if there is
+// one, for `redirect_stderr()`.
+static int open_log(const char *log_path) {
+  if (log_path == NULL) {
+    return -1;
+  }
+  return open(log_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+}
+
+// Runs in the adapter's process before the adapter is started.
+static void redirect_stderr(gpointer log_fd) {
+  if (GPOINTER_TO_INT(log_fd) >= 0) {
+    dup2(GPOINTER_TO_INT(log_fd), STDERR_FILENO);
+  }
+}
+
+/*
+ * Starts the clipboard adapter at `path` in the background. It is ready for
+ * requests right away, and looks for the clipboard tools while rofi is
+ * waiting for the user. Its errors are appended to `log_path`, unless it is
+ * NULL.
+ *
+ * Returns NULL and sets `error` if the adapter cannot be started.
+ */
+ClipboardAdapter *clipboard_adapter_start(const char *path,
+                                          const char *log_path, char **error) {
+  GPid pid;
+  gint requests;
+  gint responses;
+  GError *spawn_error = NULL;
+
+  int log_fd = open_log(log_path);
+  gboolean started = g_spawn_async_with_pipes(
+      /* working_directory */ NULL,
+      /* argv */ (char *[]){(char *)path, "serve", NULL},
+      /* envp */ NULL,
+      /* flags */ G_SPAWN_DO_NOT_REAP_CHILD,
+      /* child_setup */ redirect_stderr,
+      /* user_data */ GINT_TO_POINTER(log_fd),
+      /* child_pid */ &pid,
+      /* standard_input */ &requests,
+      /* standard_output */ &responses,
+      /* standard_error */ NULL,
+      /* error */ &spawn_error);
+  if (log_fd >= 0) {
+    close(log_fd);
+  }
+
+  if (!started) {
+    *error = g_strdup_printf("Failed to run clipboard-adapter: %s",
+                             spawn_error->message);
+    g_error_free(spawn_error);
+    return NULL;
+  }
+
+  ClipboardAdapter *adapter = g_new(ClipboardAdapter, 1);
+  adapter->pid = pid;
+  adapter->requests = requests;
+  adapter->unanswered = 0;
+  adapter->responses = fdopen(responses, "r");
+  if (adapter->responses == NULL) {
+    close(responses);
+    clipboard_adapter_stop(adapter);
+    *error = g_strdup("Failed to open clipboard-adapter's stdout");
+    return NULL;
+  }
+  return adapter;
+}
+
+// Waits up to `STOP_TIMEOUT` for the adapter to exit, and kills it otherwise.
+static void wait_or_kill(GPid pid) {
+  for (int waited = 0; waited < STOP_TIMEOUT; ++waited) {
+    // Either it exited, or it cannot be waited for at all.
+    if (waitpid(pid, NULL, WNOHANG) != 0) {
+      return;
+    }
+    g_usleep(1000);
+  }
+
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+}
+
+/*
+ * Stops the adapter once it is done with the current request, if any. Only
+ * waits for it, and briefly, if every request has been answered; otherwise it
+ * finishes on its own, even after rofi has exited.
+ */
+void clipboard_adapter_stop(ClipboardAdapter *adapter) {
+  if (adapter == NULL) {
+    return;
+  }
+
+  // The adapter exits when there are no more requests to read.
+  close(adapter->requests);
+  if (adapter->responses != NULL) {
+    fclose(adapter->responses);
+  }
+  if (adapter->unanswered == 0) {
+    wait_or_kill(adapter->pid);
+  }
+  g_spawn_close_pid(adapter->pid);
+  g_free(adapter);
+}
+
+// Writes all of `data` to `fd`. Writing to an adapter that has exited must not
+// end rofi with a SIGPIPE, so the signal is blocked and then discarded.
+static gboolean write_all(int fd, const char *data, gsize length) {
+  sigset_t pipe_signal;
+  sigset_t old_mask;
+  sigemptyset(&pipe_signal);
+  sigaddset(&pipe_signal, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe_signal, &old_mask);
+
+  int write_errno = 0;
+  while (length > 0 && write_errno == 0) {
+    ssize_t written = write(fd, data, length);
+    if (written >= 0) {
+      data += written;
+      length -= written;
+    } else if (errno != EINTR) {
+      write_errno = errno;
+    }
+  }
+
+  if (write_errno == EPIPE) {
+    struct timespec no_wait = {0, 0};
+    sigtimedwait(&pipe_signal, NULL, &no_wait);
+  }
+  pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+  return write_errno == 0;
+}
+
+static gboolean send_request(ClipboardAdapter *adapter, const char *action,
+                             const char *text) {
+  unsigned int lines = 1;
+  for (const char *c = text; *c != '\0'; ++c) {
+    lines += *c == '\n';
+  }
+
+  GString *request = g_string_new("");
+  g_string_append_printf(request, "%s %u\n%s\n", action, lines, text);
+  gboolean sent = write_all(adapter->requests, request->str, request->len);
+  g_string_free(request, TRUE);
+  return sent;
+}
+
+/*
+ * Has the adapter perform `action` ("copy", "insert" or "insert_no_copy") with
+ * `text`, and waits for it to finish, like `run_clipboard_adapter()`.
+ *
+ * Returns FALSE and sets `error` if the action failed, or the adapter is no
+ * longer running.
+ */
+int clipboard_adapter_run(ClipboardAdapter *adapter, const char *action,
+                          const char *text, char **error) {
+  char response[32];
+  for (; adapter->unanswered > 0; adapter->unanswered--) {
+    if (fgets(response, sizeof(response), adapter->responses) == NULL) {
+      break;
+    }
+  }
+
+  if (!send_request(adapter, action, text) ||
+      fgets(response, sizeof(response), adapter->responses) == NULL) {
+    *error = g_strdup("clipboard-adapter stopped unexpectedly");
+    return FALSE;
+  }
+
+  int status = atoi(response);
+  if (status == 0) {
+    *error = NULL;
+    return TRUE;
+  } else {
+    *error = g_strdup_printf("clipboard-adapter exited with %d", status);
+    return FALSE;
+  }
+}
+
+/*
+ * Like `clipboard_adapter_run()`, but does not wait for the action to finish.
+ * Only the adapter itself can report it if the action fails.
+ *
+ * Returns FALSE and sets `error` if the adapter is no longer running.
+ */
+int clipboard_adapter_send(ClipboardAdapter *adapter, const char *action,
+                           const char *text, char **error) {
+  if (!send_request(adapter, action, text)) {
+    *error = g_strdup("clipboard-adapter stopped unexpectedly");
+    return FALSE;
+  }
+
+  adapter->unanswered++;
+  *error = NULL;
+  return TRUE;
+}
+
+/*
+ * Runs the clipboard adapter at `path` to perform `action` with `text`, like
+ * `run_clipboard_adapter()`, but does not wait for it. The adapter finishes on
+ * its own, even after rofi has exited, and appends its errors to `log_path`.
+ *
+ * Returns FALSE and sets `error` if the adapter cannot be started.
+ */
+int clipboard_adapter_run_detached(const char *path, const char *action,
+                                   const char *text, const char *log_path,
+                                   char **error) {
+  int log_fd = open_log(log_path);
+
+  // Without G_SPAWN_DO_NOT_REAP_CHILD, the adapter is started by a process in
+  // between that exits right away, so it never has to be waited for.
+  GPid pid;
+  gint input;
+  GError *spawn_error = NULL;
+  gboolean started = g_spawn_async_with_pipes(
+      /* working_directory */ NULL,
+      /* argv */ (char *[]){(char *)path, (char *)action, NULL},
+      /* envp */ NULL,
+      /* flags */ G_SPAWN_DEFAULT,
+      /* child_setup */ redirect_stderr,
+      /* user_data */ GINT_TO_POINTER(log_fd),
+      /* child_pid */ &pid,
+      /* standard_input */ &input,
+      /* standard_output */ NULL,
+      /* standard_error */ NULL,
+      /* error */ &spawn_error);
+  if (log_fd >= 0) {
+    close(log_fd);
+  }
+
+  if (!started) {
+    *error = g_strdup_printf("Failed to run clipboard-adapter: %s",
+                             spawn_error->message);
+    g_error_free(spawn_error);
+    return FALSE;
+  }
+
+  // The adapter reads all of its input before doing anything, so this only
+  // waits for it to start.
+  gboolean sent = write_all(input, text, strlen(text));
+  close(input);
+  if (!sent) {
+    *error = g_strdup("clipboard-adapter stopped unexpectedly");
+    return FALSE;
+  }
+
+  *error = NULL;
+  return TRUE;
+}
@@ -0,0 +1,23 @@
+#ifndef ADAPTER_H
+#define ADAPTER_H
+
+#include <glib.h>
+
+// A clipboard adapter that keeps running in the background to handle every
+// copy and insert, see `clipboard-adapter.sh serve`.
+typedef struct ClipboardAdapter ClipboardAdapter;
+
+ClipboardAdapter *clipboard_adapter_start(const char *path,
+                                          const char *log_path, char **error);
+void clipboard_adapter_stop(ClipboardAdapter *adapter);
+
+int clipboard_adapter_run(ClipboardAdapter *adapter, const char *action,
+                          const char *text, char **error);
+int clipboard_adapter_send(ClipboardAdapter *adapter, const char *action,
+                           const char *text, char **error);
+
+int clipboard_adapter_run_detached(const char *path, const char *action,
+                                   const char *text, const char *log_path,
+                                   char **error);
+
+#endif // ADAPTER_H
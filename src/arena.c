@@ -0,0 +1,95 @@
+#include <glib.h>
+#include <string.h>
+
+#include "arena.h"
+
+// A simple bump allocator. Memory is handed out from large blocks and is only
+// released all at once when the arena is freed, which makes it a good fit for
+// data that lives exactly as long as the emoji table that owns it.
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT sizeof(void *)
+
+typedef struct ArenaBlock {
+  struct ArenaBlock *next;
+  size_t size;
+  size_t used;
+  char data[];
+} ArenaBlock;
+
+struct Arena {
+  // The block currently being filled is always first.
+  ArenaBlock *blocks;
+};
+
+static ArenaBlock *arena_block_new(size_t size) {
+  ArenaBlock *block = g_malloc(sizeof(ArenaBlock) + size);
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
+  return block;
+}
+
+Arena *arena_new(void) {
+  Arena *arena = g_new(Arena, 1);
+  arena->blocks = NULL;
+  return arena;
+}
+
+void arena_free(Arena *arena) {
+  if (arena == NULL) {
+    return;
+  }
+
+  ArenaBlock *block = arena->blocks;
+  while (block != NULL) {
+    ArenaBlock *next = block->next;
+    g_free(block);
+    block = next;
+  }
+  g_free(arena);
+}
+
+/*
+ * Allocates `size` bytes of pointer-aligned, uninitialized memory that is
+ * owned by the arena.
+ */
+void *arena_alloc(Arena *arena, size_t size) {
+  size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+  ArenaBlock *block = arena->blocks;
+  if (block == NULL || block->size - block->used < size) {
+    if (size > ARENA_BLOCK_SIZE / 4) {
+      // Large allocations get a block of their own, placed behind the current
+      // one so the space left in it can still be used.
+      ArenaBlock *large = arena_block_new(size);
+      large->used = size;
+      if (block == NULL) {
+        arena->blocks = large;
+      } else {
+        large->next = block->next;
+        block->next = large;
+      }
+      return large->data;
+    }
+
+    block = arena_block_new(ARENA_BLOCK_SIZE);
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+
+  void *memory = block->data + block->used;
+  block->used += size;
+  return memory;
+}
+
+char *arena_strndup(Arena *arena, const char *str, size_t length) {
+  char *copy = arena_alloc(arena, length + 1);
+  memcpy(copy, str, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+char *arena_strdup(Arena *arena, const char *str) {
+  return arena_strndup(arena, str, strlen(str));
+}
@@ -0,0 +1,106 @@
+#include <glib.h>
+#include <string.h>
+
+#include "bitset.h"
+
+/*
+ * Creates a new bitset able to hold `size` bits, all of them cleared.
+ */
+Bitset *bitset_new(unsigned int size) {
+  Bitset *bitset = g_new(Bitset, 1);
+  bitset->words = g_new0(guint64, MAX(BITSET_WORDS(size), 1));
+  bitset->size = size;
+  return bitset;
+}
+
+Bitset *bitset_copy(const Bitset *bitset) {
+  Bitset *copy = bitset_new(bitset->size);
+  memcpy(copy->words, bitset->words,
+         BITSET_WORDS(bitset->size) * sizeof(guint64));
+  return copy;
+}
+
+void bitset_free(Bitset *bitset) {
+  if (bitset == NULL) {
+    return;
+  }
+
+  g_free(bitset->words);
+  g_free(bitset);
+}
+
+/*
+ * Sets every bit in the set. Bits past the size of the set in the last word
+ * are kept cleared so that counting stays correct.
+ */
+void bitset_fill(Bitset *bitset) {
+  unsigned int words = BITSET_WORDS(bitset->size);
+  if (words == 0) {
+    return;
+  }
+
+  memset(bitset->words, 0xff, words * sizeof(guint64));
+
+  unsigned int tail = bitset->size % BITSET_WORD_BITS;
+  if (tail != 0) {
+    bitset->words[words - 1] = ((guint64)1 << tail) - 1;
+  }
+}
+
+/*
+ * Keeps only the bits that are also set in `other`, which must have the same
+ * size.
+ */
+void bitset_and(Bitset *bitset, const Bitset *other) {
+  unsigned int words = BITSET_WORDS(bitset->size);
+  for (unsigned int i = 0; i < words; ++i) {
+    bitset->words[i] &= other->words[i];
+  }
+}
+
+unsigned int bitset_count(const Bitset *bitset) {
+  unsigned int count = 0;
+  unsigned int words = BITSET_WORDS(bitset->size);
+  for (unsigned int i = 0; i < words; ++i) {
+    count += __builtin_popcountll(bitset->words[i]);
+  }
+  return count;
+}
+
+/*
+ * Returns the first set bit at or after `index`, or the size of the set if
+ * there is none. Iterate over all set bits with:
+ *
+ *   for (i = bitset_next(set, 0); i < set->size; i = bitset_next(set, i + 1))
+ */
+unsigned int bitset_next(const Bitset *bitset, unsigned int index) {
+  return bitset_next_before(bitset, index, bitset->size);
+}
+
+/*
+ * Returns the first set bit at or after `index` and before `limit`, or `limit`
+ * if there is none. Words past the one holding `limit - 1` are never read, so
+ * other threads may modify them meanwhile.
+ */
+unsigned int bitset_next_before(const Bitset *bitset, unsigned int index,
+                                unsigned int limit) {
+  limit = MIN(limit, bitset->size);
+  if (index >= limit) {
+    return limit;
+  }
+
+  unsigned int word = index / BITSET_WORD_BITS;
+  unsigned int last_word = (limit - 1) / BITSET_WORD_BITS;
+  guint64 bits =
+      bitset->words[word] & (~(guint64)0 << (index % BITSET_WORD_BITS));
+
+  while (bits == 0) {
+    if (++word > last_word) {
+      return limit;
+    }
+    bits = bitset->words[word];
+  }
+
+  unsigned int next = word * BITSET_WORD_BITS + __builtin_ctzll(bits);
+  return MIN(next, limit);
+}
@@ -0,0 +1,43 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <glib.h>
+
+// A fixed-size set of row indexes, used to answer per-row questions with a
+// single bit test.
+typedef struct Bitset {
+  guint64 *words;
+  unsigned int size;
+} Bitset;
+
+#define BITSET_WORD_BITS 64
+#define BITSET_WORDS(size) (((size) + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS)
+
+Bitset *bitset_new(unsigned int size);
+Bitset *bitset_copy(const Bitset *bitset);
+void bitset_free(Bitset *bitset);
+
+void bitset_fill(Bitset *bitset);
+void bitset_and(Bitset *bitset, const Bitset *other);
+unsigned int bitset_count(const Bitset *bitset);
+unsigned int bitset_next(const Bitset *bitset, unsigned int index);
+unsigned int bitset_next_before(const Bitset *bitset, unsigned int index,
+                                unsigned int limit);
+
+static inline void bitset_set(Bitset *bitset, unsigned int index) {
+  bitset->words[index / BITSET_WORD_BITS] |=
+      (guint64)1 << (index % BITSET_WORD_BITS);
+}
+
+static inline void bitset_clear(Bitset *bitset, unsigned int index) {
+  bitset->words[index / BITSET_WORD_BITS] &=
+      ~((guint64)1 << (index % BITSET_WORD_BITS));
+}
+
+static inline gboolean bitset_get(const Bitset *bitset, unsigned int index) {
+  return (bitset->words[index / BITSET_WORD_BITS] >>
+          (index % BITSET_WORD_BITS)) &
+         1;
+}
+
+#endif // BITSET_H
@@ -0,0 +1,116 @@
+#include <glib.h>
+
+#include "cache.h"
+
+typedef struct {
+  gpointer key;
+  gpointer value;
+  gsize cost;
+} CacheEntry;
+
+/*
+ * Creates an empty cache that holds entries up to a total cost of `budget`.
+ * The cache takes ownership of inserted keys and values and frees them with
+ * `key_destroy` and `value_destroy`, either of which may be NULL.
+ */
+Cache *cache_new(gsize budget, GHashFunc hash_func, GEqualFunc key_equal_func,
+                 GDestroyNotify key_destroy, GDestroyNotify value_destroy) {
+  Cache *cache = g_new(Cache, 1);
+  // Maps keys to their link in `order`.
+  cache->entries = g_hash_table_new(hash_func, key_equal_func);
+  g_queue_init(&cache->order);
+  cache->budget = budget;
+  cache->cost = 0;
+  cache->key_destroy = key_destroy;
+  cache->value_destroy = value_destroy;
+  cache->hits = 0;
+  cache->misses = 0;
+
+  return cache;
+}
+
+static void remove_link(Cache *cache, GList *link) {
+  CacheEntry *entry = link->data;
+
+  g_hash_table_remove(cache->entries, entry->key);
+  g_queue_delete_link(&cache->order, link);
+  cache->cost -= entry->cost;
+
+  if (cache->key_destroy != NULL) {
+    cache->key_destroy(entry->key);
+  }
+  if (cache->value_destroy != NULL) {
+    cache->value_destroy(entry->value);
+  }
+  g_free(entry);
+}
+
+void cache_clear(Cache *cache) {
+  while (cache->order.tail != NULL) {
+    remove_link(cache, cache->order.tail);
+  }
+}
+
+void cache_free(Cache *cache) {
+  if (cache == NULL) {
+    return;
+  }
+
+  cache_clear(cache);
+  g_hash_table_destroy(cache->entries);
+  g_free(cache);
+}
+
+/*
+ * Returns the value stored for `key` and marks it as the most recently used
+ * entry, or NULL if there is none. The value is still owned by the cache and
+ * is only valid until the next insert.
+ */
+gpointer cache_lookup(Cache *cache, gconstpointer key) {
+  GList *link = g_hash_table_lookup(cache->entries, key);
+  if (link == NULL) {
+    cache->misses++;
+    return NULL;
+  }
+
+  cache->hits++;
+  g_queue_unlink(&cache->order, link);
+  g_queue_push_head_link(&cache->order, link);
+
+  return ((CacheEntry *)link->data)->value;
+}
+
+/*
+ * Stores `value` for `key`, replacing any previous value, and evicts the least
+ * recently used entries until the cache fits its budget again. An entry that
+ * costs more than the whole budget is not stored at all.
+ */
+void cache_insert(Cache *cache, gpointer key, gpointer value, gsize cost) {
+  GList *existing = g_hash_table_lookup(cache->entries, key);
+  if (existing != NULL) {
+    remove_link(cache, existing);
+  }
+
+  if (cost > cache->budget) {
+    if (cache->key_destroy != NULL) {
+      cache->key_destroy(key);
+    }
+    if (cache->value_destroy != NULL) {
+      cache->value_destroy(value);
+    }
+    return;
+  }
+
+  while (cache->cost + cost > cache->budget) {
+    remove_link(cache, cache->order.tail);
+  }
+
+  CacheEntry *entry = g_new(CacheEntry, 1);
+  entry->key = key;
+  entry->value = value;
+  entry->cost = cost;
+
+  g_queue_push_head(&cache->order, entry);
+  g_hash_table_insert(cache->entries, key, cache->order.head);
+  cache->cost += cost;
+}
@@ -0,0 +1,30 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <glib.h>
+
+// A least-recently-used cache with a fixed budget. Every entry has a cost
+// (for example its size in bytes) and the least recently used entries are
+// evicted whenever the total cost goes over the budget.
+typedef struct Cache {
+  GHashTable *entries;
+  // Most recently used entry first.
+  GQueue order;
+  gsize budget;
+  gsize cost;
+  GDestroyNotify key_destroy;
+  GDestroyNotify value_destroy;
+
+  guint64 hits;
+  guint64 misses;
+} Cache;
+
+Cache *cache_new(gsize budget, GHashFunc hash_func, GEqualFunc key_equal_func,
+                 GDestroyNotify key_destroy, GDestroyNotify value_destroy);
+void cache_free(Cache *cache);
+
+gpointer cache_lookup(Cache *cache, gconstpointer key);
+void cache_insert(Cache *cache, gpointer key, gpointer value, gsize cost);
+void cache_clear(Cache *cache);
+
+#endif // CACHE_H
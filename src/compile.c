@@ -0,0 +1,125 @@
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "formatter.h"
+#include "loader.h"
+#include "snapshot.h"
+
+// Number of 64-bit words per line of a generated C source.
+#define WORDS_PER_LINE 3
+
+/*
+ * Writes a snapshot of `emojis` as a C source that defines the symbols in
+ * `embedded.h`, so that it ends up in the read-only data of the plugin.
+ */
+static int write_c_source(EmojiTable *emojis, const char *source_path,
+                          const SkippedLines *skipped, const char *path,
+                          char **error) {
+  SnapshotSource source;
+  if (!snapshot_source_identify(source_path, &source)) {
+    *error = g_strdup_printf("Cannot read %s", source_path);
+    return FALSE;
+  }
+
+  char **matcher_strings = generate_matcher_strings(emojis);
+  Snapshot snapshot = {
+      .emojis = emojis,
+      .strings = literal_matcher_new(matcher_strings, emojis->len),
+      .index = trigram_index_new(matcher_strings, emojis->len),
+      .skipped = *skipped,
+  };
+  g_strfreev(matcher_strings);
+
+  // Only the name of the emoji file is recorded, and not when it was last
+  // modified, so that the output does not depend on where or when it was
+  // built. The embedded snapshot is never checked against a file anyway.
+  source.mtime = 0;
+  char *name = g_path_get_basename(source_path);
+  GString *data = g_string_sized_new(4 * 1024 * 1024);
+  emoji_snapshot_append(&snapshot, name, &source, data);
+  gsize size = data->len;
+  while (data->len % sizeof(guint64) != 0) {
+    g_string_append_c(data, '\0');
+  }
+
+  GString *out = g_string_sized_new(data->len * 3);
+  g_string_append_printf(out,
+                         "// Generated from %s by rofi-emoji-compile. "
+                         "Do not edit.\n\n"
+                         "#include \"src/embedded.h\"\n\n"
+                         "const guint64 embedded_snapshot[] = {\n",
+                         name);
+  for (gsize i = 0; i < data->len / sizeof(guint64); ++i) {
+    guint64 word;
+    memcpy(&word, data->str + i * sizeof(guint64), sizeof(word));
+    g_string_append_printf(out, "%s0x%016" G_GINT64_MODIFIER "x,%s",
+                           i % WORDS_PER_LINE == 0 ? "    " : " ", word,
+                           i % WORDS_PER_LINE == WORDS_PER_LINE - 1 ? "\n"
+                                                                    : "");
+  }
+  if (data->len / sizeof(guint64) % WORDS_PER_LINE != 0) {
+    g_string_append_c(out, '\n');
+  }
+  g_string_append_printf(out,
+                         "};\n\n"
+                         "const gsize embedded_snapshot_size = %" G_GSIZE_FORMAT
+                         ";\n",
+                         size);
+
+  GError *write_error = NULL;
+  int success = g_file_set_contents(path, out->str, out->len, &write_error);
+  if (!success) {
+    *error = g_strdup_printf("Cannot write %s: %s", path, write_error->message);
+    g_error_free(write_error);
+  }
+
+  g_string_free(out, TRUE);
+  g_string_free(data, TRUE);
+  g_free(name);
+  literal_matcher_free(snapshot.strings);
+  trigram_index_free(snapshot.index);
+  return success;
+}
+
+/*
+ * Compiles an emoji text file into a C source of a snapshot of everything the
+ * plugin builds out of it, which is linked into the plugin.
+ *
+ * Usage: rofi-emoji-compile all_emojis.txt all_emojis.c
+ */
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <emoji file> <C source file>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const char *source_path = argv[1];
+  const char *path = argv[2];
+
+  SkippedLines skipped;
+  EmojiTable *emojis = read_emojis_from_file(source_path, &skipped);
+  if (emojis == NULL) {
+    fprintf(stderr, "%s: Cannot read %s\n", argv[0], source_path);
+    return EXIT_FAILURE;
+  }
+
+  for (unsigned int i = 0; i < MIN(skipped.count, MAX_REPORTED_LINES); ++i) {
+    fprintf(stderr, "%s: %s:%u: Skipping line that cannot be parsed\n",
+            argv[0], source_path, skipped.lines[i]);
+  }
+  if (skipped.count > MAX_REPORTED_LINES) {
+    fprintf(stderr, "%s: %s: Skipping %u more lines\n", argv[0], source_path,
+            skipped.count - MAX_REPORTED_LINES);
+  }
+
+  char *error = NULL;
+  int success = write_c_source(emojis, source_path, &skipped, path, &error);
+  if (!success) {
+    fprintf(stderr, "%s: %s\n", argv[0], error);
+    g_free(error);
+  }
+
+  emoji_table_free(emojis);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,321 @@
+#include <glib.h>
+#include <string.h>
+
+#include "database.h"
+
+// The database format stores an emoji table as a single read-only blob that
+// can be mapped into memory and used without any parsing:
+//
+//   [header][emojis][names][group IDs][subgroup IDs][keyword offsets]
+//   [keyword IDs][group table][subgroup table][keyword dictionary][strings]
+//
+// The sections up to the keyword IDs are the arrays of an `EmojiTable`, one
+// entry per emoji (and one more for the keyword offsets), and are used as
+// they are. The group, subgroup and keyword IDs index the tables after them.
+// Emojis, names and the tables refer to the string pool by byte offset. Every
+// string in the pool is NUL-terminated and identical strings are only stored
+// once.
+//
+// It is not written to a file of its own, but is the emoji table section of a
+// snapshot (see `snapshot.c`), which decides when it is stale.
+
+#define DATABASE_MAGIC "RFEMOJI"
+#define DATABASE_VERSION 3
+#define DATABASE_BYTE_ORDER 0x01020304
+
+typedef struct {
+  char magic[8];
+  guint32 version;
+  guint32 byte_order;
+  guint64 source_size;
+  guint32 emoji_count;
+  guint32 group_count;
+  guint32 subgroup_count;
+  guint32 dictionary_count;
+  guint32 keyword_count;
+  guint32 bytes_offset;
+  guint32 names_offset;
+  guint32 group_ids_offset;
+  guint32 subgroup_ids_offset;
+  guint32 keyword_offsets_offset;
+  guint32 keyword_ids_offset;
+  guint32 groups_offset;
+  guint32 subgroups_offset;
+  guint32 dictionary_offset;
+  guint32 strings_offset;
+  guint32 strings_size;
+} DatabaseHeader;
+
+typedef struct {
+  GString *data;
+  GHashTable *offsets;
+} StringPool;
+
+static guint32 string_pool_add(StringPool *pool, const char *str) {
+  gpointer offset;
+  if (g_hash_table_lookup_extended(pool->offsets, str, NULL, &offset)) {
+    return GPOINTER_TO_UINT(offset);
+  }
+
+  guint32 new_offset = pool->data->len;
+  g_string_append_len(pool->data, str, strlen(str) + 1);
+  g_hash_table_insert(pool->offsets, g_strdup(str),
+                      GUINT_TO_POINTER(new_offset));
+  return new_offset;
+}
+
+/*
+ * Appends `emojis` in the database format to `out`, recording `source_size` as
+ * the size of the text file they were read from.
+ */
+void emoji_database_append(const EmojiTable *emojis, guint64 source_size,
+                           GString *out) {
+  StringPool pool = {
+      .data = g_string_sized_new(256 * 1024),
+      .offsets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL),
+  };
+
+  GArray *groups = g_array_new(FALSE, FALSE, sizeof(guint32));
+  GArray *subgroups = g_array_new(FALSE, FALSE, sizeof(guint32));
+  GArray *dictionary = g_array_new(FALSE, FALSE, sizeof(guint32));
+  guint32 *bytes = g_new(guint32, MAX(emojis->len, 1));
+  guint32 *names = g_new(guint32, MAX(emojis->len, 1));
+
+  // Group, subgroup and keyword IDs of the table are used as-is.
+  for (guint i = 0; i < emojis->groups->len; ++i) {
+    guint32 offset =
+        string_pool_add(&pool, g_ptr_array_index(emojis->groups, i));
+    g_array_append_val(groups, offset);
+  }
+  for (guint i = 0; i < emojis->subgroups->len; ++i) {
+    guint32 offset =
+        string_pool_add(&pool, g_ptr_array_index(emojis->subgroups, i));
+    g_array_append_val(subgroups, offset);
+  }
+  for (guint i = 0; i < emojis->keywords->keywords->len; ++i) {
+    guint32 offset = string_pool_add(
+        &pool, keyword_dictionary_get(emojis->keywords, i));
+    g_array_append_val(dictionary, offset);
+  }
+  for (guint i = 0; i < emojis->len; ++i) {
+    bytes[i] = string_pool_add(&pool, emoji_table_bytes(emojis, i));
+    names[i] = string_pool_add(&pool, emoji_table_name(emojis, i));
+  }
+
+  gsize column_size = emojis->len * sizeof(guint32);
+  DatabaseHeader header = {
+      .magic = DATABASE_MAGIC,
+      .version = DATABASE_VERSION,
+      .byte_order = DATABASE_BYTE_ORDER,
+      .source_size = source_size,
+      .emoji_count = emojis->len,
+      .group_count = groups->len,
+      .subgroup_count = subgroups->len,
+      .dictionary_count = dictionary->len,
+      .keyword_count = emojis->keyword_offsets[emojis->len],
+  };
+  header.bytes_offset = sizeof(DatabaseHeader);
+  header.names_offset = header.bytes_offset + column_size;
+  header.group_ids_offset = header.names_offset + column_size;
+  header.subgroup_ids_offset = header.group_ids_offset + column_size;
+  header.keyword_offsets_offset = header.subgroup_ids_offset + column_size;
+  header.keyword_ids_offset =
+      header.keyword_offsets_offset + column_size + sizeof(guint32);
+  header.groups_offset =
+      header.keyword_ids_offset + header.keyword_count * sizeof(guint32);
+  header.subgroups_offset =
+      header.groups_offset + groups->len * sizeof(guint32);
+  header.dictionary_offset =
+      header.subgroups_offset + subgroups->len * sizeof(guint32);
+  header.strings_offset =
+      header.dictionary_offset + dictionary->len * sizeof(guint32);
+  header.strings_size = pool.data->len;
+
+  g_string_append_len(out, (const char *)&header, sizeof(header));
+  g_string_append_len(out, (const char *)bytes, column_size);
+  g_string_append_len(out, (const char *)names, column_size);
+  g_string_append_len(out, (const char *)emojis->group_ids, column_size);
+  g_string_append_len(out, (const char *)emojis->subgroup_ids, column_size);
+  g_string_append_len(out, (const char *)emojis->keyword_offsets,
+                      column_size + sizeof(guint32));
+  g_string_append_len(out, (const char *)emojis->keyword_ids,
+                      header.keyword_count * sizeof(guint32));
+  g_string_append_len(out, groups->data, groups->len * sizeof(guint32));
+  g_string_append_len(out, subgroups->data, subgroups->len * sizeof(guint32));
+  g_string_append_len(out, dictionary->data,
+                      dictionary->len * sizeof(guint32));
+  g_string_append_len(out, pool.data->str, pool.data->len);
+
+  g_free(bytes);
+  g_free(names);
+  g_array_free(groups, TRUE);
+  g_array_free(subgroups, TRUE);
+  g_array_free(dictionary, TRUE);
+  g_hash_table_destroy(pool.offsets);
+  g_string_free(pool.data, TRUE);
+}
+
+static int section_fits(guint64 offset, guint64 count, guint64 size,
+                        guint64 length) {
+  return offset % sizeof(guint32) == 0 && offset + count * size <= length;
+}
+
+static int valid_offsets(const guint32 *offsets, guint32 count,
+                         guint32 strings_size) {
+  for (guint32 i = 0; i < count; ++i) {
+    if (offsets[i] >= strings_size) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static int valid_ids(const guint32 *ids, guint32 count, guint32 limit) {
+  for (guint32 i = 0; i < count; ++i) {
+    if (ids[i] >= limit) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// The section of the database that `header` says is at `name##_offset`.
+#define SECTION(header, name) \
+  ((const guint32 *)((const char *)(header) + (header)->name##_offset))
+
+// Checks that every offset and index in the database points inside of the
+// mapping, so that a truncated or corrupt file can never be read out of
+// bounds.
+static int validate_database(const char *data, gsize length,
+                             guint64 source_size) {
+  if (length < sizeof(DatabaseHeader)) {
+    return FALSE;
+  }
+
+  const DatabaseHeader *header = (const DatabaseHeader *)data;
+  if (memcmp(header->magic, DATABASE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != DATABASE_VERSION ||
+      header->byte_order != DATABASE_BYTE_ORDER ||
+      header->source_size != source_size) {
+    return FALSE;
+  }
+
+  guint32 count = header->emoji_count;
+  if (!section_fits(header->bytes_offset, count, sizeof(guint32), length) ||
+      !section_fits(header->names_offset, count, sizeof(guint32), length) ||
+      !section_fits(header->group_ids_offset, count, sizeof(guint32),
+                    length) ||
+      !section_fits(header->subgroup_ids_offset, count, sizeof(guint32),
+                    length) ||
+      !section_fits(header->keyword_offsets_offset, (guint64)count + 1,
+                    sizeof(guint32), length) ||
+      !section_fits(header->keyword_ids_offset, header->keyword_count,
+                    sizeof(guint32), length) ||
+      !section_fits(header->groups_offset, header->group_count,
+                    sizeof(guint32), length) ||
+      !section_fits(header->subgroups_offset, header->subgroup_count,
+                    sizeof(guint32), length) ||
+      !section_fits(header->dictionary_offset, header->dictionary_count,
+                    sizeof(guint32), length) ||
+      !section_fits(header->strings_offset, header->strings_size, 1, length)) {
+    return FALSE;
+  }
+
+  const char *strings = data + header->strings_offset;
+  if (header->strings_size == 0 || strings[header->strings_size - 1] != '\0') {
+    return FALSE;
+  }
+
+  if (!valid_offsets(SECTION(header, bytes), count, header->strings_size) ||
+      !valid_offsets(SECTION(header, names), count, header->strings_size) ||
+      !valid_offsets(SECTION(header, groups), header->group_count,
+                     header->strings_size) ||
+      !valid_offsets(SECTION(header, subgroups), header->subgroup_count,
+                     header->strings_size) ||
+      !valid_offsets(SECTION(header, dictionary), header->dictionary_count,
+                     header->strings_size)) {
+    return FALSE;
+  }
+
+  if (!valid_ids(SECTION(header, group_ids), count, header->group_count) ||
+      !valid_ids(SECTION(header, subgroup_ids), count,
+                 header->subgroup_count) ||
+      !valid_ids(SECTION(header, keyword_ids), header->keyword_count,
+                 header->dictionary_count)) {
+    return FALSE;
+  }
+
+  // The keywords of every emoji must be a range of the keyword IDs.
+  const guint32 *keyword_offsets = SECTION(header, keyword_offsets);
+  if (keyword_offsets[0] != 0 ||
+      keyword_offsets[count] != header->keyword_count) {
+    return FALSE;
+  }
+  for (guint32 i = 0; i < count; ++i) {
+    if (keyword_offsets[i] > keyword_offsets[i + 1]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Uses the `length` bytes at `offset` in `bytes`, written by
+ * `emoji_database_append()`, as an emoji table. The arrays and strings of the
+ * table are not copied; they point into `bytes`, which the table keeps a
+ * reference to.
+ *
+ * Returns NULL if the data is invalid, or was not written for a text file of
+ * `source_size` bytes.
+ */
+EmojiTable *emoji_database_map(GBytes *bytes, gsize offset, gsize length,
+                               guint64 source_size) {
+  gsize size;
+  const char *data = g_bytes_get_data(bytes, &size);
+  if (data == NULL || offset % sizeof(guint64) != 0 || offset + length > size) {
+    return NULL;
+  }
+
+  data += offset;
+  if (!validate_database(data, length, source_size)) {
+    return NULL;
+  }
+
+  const DatabaseHeader *header = (const DatabaseHeader *)data;
+  const guint32 *groups = SECTION(header, groups);
+  const guint32 *subgroups = SECTION(header, subgroups);
+  const guint32 *dictionary = SECTION(header, dictionary);
+  char *strings = (char *)(data + header->strings_offset);
+
+  EmojiTable *table = emoji_table_new_mapped(g_bytes_ref(bytes));
+  table->len = header->emoji_count;
+  table->bytes = (guint32 *)SECTION(header, bytes);
+  table->names = (guint32 *)SECTION(header, names);
+  table->group_ids = (guint32 *)SECTION(header, group_ids);
+  table->subgroup_ids = (guint32 *)SECTION(header, subgroup_ids);
+  table->keyword_offsets = (guint32 *)SECTION(header, keyword_offsets);
+  table->keyword_ids = (guint32 *)SECTION(header, keyword_ids);
+  table->strings = strings;
+  table->strings_length = header->strings_size;
+
+  // Group, subgroup and keyword IDs are used as they are, so they must get
+  // the same IDs in the table as in the database.
+  for (guint32 i = 0; i < header->group_count; ++i) {
+    if (emoji_table_intern_group(table, strings + groups[i]) != i) {
+      emoji_table_free(table);
+      return NULL;
+    }
+  }
+  for (guint32 i = 0; i < header->subgroup_count; ++i) {
+    if (emoji_table_intern_subgroup(table, strings + subgroups[i]) != i) {
+      emoji_table_free(table);
+      return NULL;
+    }
+  }
+  for (guint32 i = 0; i < header->dictionary_count; ++i) {
+    keyword_dictionary_append(table->keywords, strings + dictionary[i]);
+  }
+
+  return table;
+}
@@ -0,0 +1,13 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <glib.h>
+
+#include "emoji.h"
+
+void emoji_database_append(const EmojiTable *emojis, guint64 source_size,
+                           GString *out);
+EmojiTable *emoji_database_map(GBytes *bytes, gsize offset, gsize length,
+                               guint64 source_size);
+
+#endif // DATABASE_H
@@ -0,0 +1,12 @@
+#ifndef EMBEDDED_H
+#define EMBEDDED_H
+
+#include <glib.h>
+
+// A snapshot of the bundled `all_emojis.txt`, written into `all_emojis.c` by
+// `rofi-emoji-compile` at build time and linked into the plugin.
+// Stored as 64-bit words so that it is aligned like a mapped snapshot.
+extern const guint64 embedded_snapshot[];
+extern const gsize embedded_snapshot_size;
+
+#endif // EMBEDDED_H
@@ -1,23 +1,240 @@
 #include <glib.h>
+#include <string.h>
 
 #include "emoji.h"
 
-Emoji *emoji_new(char *bytes, char *name, char *group, char *subgroup,
-                 char **keywords) {
-  Emoji *emoji = g_new(Emoji, 1);
-  emoji->bytes = bytes;
-  emoji->name = name;
-  emoji->group = group;
-  emoji->subgroup = subgroup;
-  emoji->keywords = keywords;
-  return emoji;
-}
-
-void emoji_free(Emoji *emoji) {
-  g_free(emoji->bytes);
-  g_free(emoji->name);
-  g_free(emoji->group);
-  g_free(emoji->subgroup);
-  g_strfreev(emoji->keywords);
-  g_free(emoji);
+static EmojiTable *table_new(GBytes *database) {
+  EmojiTable *table = g_new(EmojiTable, 1);
+  table->len = 0;
+  table->allocated = 0;
+  table->bytes = NULL;
+  table->names = NULL;
+  table->group_ids = NULL;
+  table->subgroup_ids = NULL;
+  table->keyword_offsets = NULL;
+  table->keyword_ids = NULL;
+  table->keyword_ids_allocated = 0;
+  table->strings = NULL;
+  table->strings_length = 0;
+  table->strings_allocated = 0;
+  table->groups = g_ptr_array_new();
+  table->subgroups = g_ptr_array_new();
+  table->group_ids_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+  table->subgroup_ids_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+  table->keywords = keyword_dictionary_new();
+  table->arena = arena_new();
+  table->database = database;
+  return table;
+}
+
+EmojiTable *emoji_table_new(unsigned int reserved_size) {
+  EmojiTable *table = table_new(NULL);
+  emoji_table_reserve(table, MAX(reserved_size, 1));
+  table->keyword_offsets[0] = 0;
+  return table;
+}
+
+/*
+ * Returns an empty table that takes ownership of `database`. Its arrays are
+ * meant to be pointed into the database by the caller, and no emojis can be
+ * added to it.
+ */
+EmojiTable *emoji_table_new_mapped(GBytes *database) {
+  return table_new(database);
+}
+
+void emoji_table_free(EmojiTable *table) {
+  if (table == NULL) {
+    return;
+  }
+
+  // The arrays of a table read from a database belong to the database.
+  if (table->database == NULL) {
+    g_free(table->bytes);
+    g_free(table->names);
+    g_free(table->group_ids);
+    g_free(table->subgroup_ids);
+    g_free(table->keyword_offsets);
+    g_free(table->keyword_ids);
+    g_free(table->strings);
+  } else {
+    g_bytes_unref(table->database);
+  }
+  g_ptr_array_free(table->groups, TRUE);
+  g_ptr_array_free(table->subgroups, TRUE);
+  g_hash_table_destroy(table->group_ids_by_name);
+  g_hash_table_destroy(table->subgroup_ids_by_name);
+  keyword_dictionary_free(table->keywords);
+  arena_free(table->arena);
+  g_free(table);
+}
+
+/*
+ * Makes room for at least `size` emojis in total, so that adding them does not
+ * have to grow the table again.
+ */
+void emoji_table_reserve(EmojiTable *table, unsigned int size) {
+  g_return_if_fail(table->database == NULL);
+
+  if (size > table->allocated) {
+    table->allocated = size;
+    table->bytes = g_renew(guint32, table->bytes, size);
+    table->names = g_renew(guint32, table->names, size);
+    table->group_ids = g_renew(guint32, table->group_ids, size);
+    table->subgroup_ids = g_renew(guint32, table->subgroup_ids, size);
+    table->keyword_offsets =
+        g_renew(guint32, table->keyword_offsets, size + 1);
+  }
+}
+
+// Returns room for `length` more items of `size` bytes at the end of
+// `array`, which holds `used` items and has room for `*allocated`.
+static void *grow(void **array, gsize *allocated, gsize used, gsize length,
+                  gsize size) {
+  if (used + length > *allocated) {
+    *allocated = MAX(used + length, MAX(*allocated * 2, 1024));
+    *array = g_realloc(*array, *allocated * size);
+  }
+  return (char *)*array + used * size;
+}
+
+static guint32 add_string(EmojiTable *table, const char *str) {
+  gsize length = strlen(str) + 1;
+  guint32 offset = table->strings_length;
+  memcpy(grow((void **)&table->strings, &table->strings_allocated,
+              table->strings_length, length, 1),
+         str, length);
+  table->strings_length += length;
+  return offset;
+}
+
+/*
+ * Appends an emoji to the end of the table and returns its row. The emoji and
+ * name are copied into the table, and the group, subgroup and keyword IDs must
+ * belong to it.
+ */
+unsigned int emoji_table_add(EmojiTable *table, const char *bytes,
+                             const char *name, unsigned int group_id,
+                             unsigned int subgroup_id,
+                             const guint32 *keyword_ids,
+                             unsigned int keyword_count) {
+  g_return_val_if_fail(table->database == NULL, 0);
+
+  if (table->len == table->allocated) {
+    emoji_table_reserve(table, table->allocated * 2);
+  }
+
+  unsigned int row = table->len++;
+  table->bytes[row] = add_string(table, bytes);
+  table->names[row] = add_string(table, name);
+  table->group_ids[row] = group_id;
+  table->subgroup_ids[row] = subgroup_id;
+
+  guint32 first = table->keyword_offsets[row];
+  if (keyword_count > 0) {
+    memcpy(grow((void **)&table->keyword_ids, &table->keyword_ids_allocated,
+                first, keyword_count, sizeof(guint32)),
+           keyword_ids, keyword_count * sizeof(guint32));
+  }
+  table->keyword_offsets[row + 1] = first + keyword_count;
+  return row;
+}
+
+/*
+ * Appends all emojis of `from` to the end of the table. Its strings are copied
+ * in one go, and its groups, subgroups and keywords get the IDs they would
+ * have gotten if its emojis had been added to the table one by one.
+ */
+void emoji_table_append(EmojiTable *table, const EmojiTable *from) {
+  g_return_if_fail(table->database == NULL);
+
+  guint32 *group_ids = g_new(guint32, MAX(from->groups->len, 1));
+  for (guint i = 0; i < from->groups->len; ++i) {
+    group_ids[i] =
+        emoji_table_add_group(table, g_ptr_array_index(from->groups, i));
+  }
+  guint32 *subgroup_ids = g_new(guint32, MAX(from->subgroups->len, 1));
+  for (guint i = 0; i < from->subgroups->len; ++i) {
+    subgroup_ids[i] = emoji_table_add_subgroup(
+        table, g_ptr_array_index(from->subgroups, i));
+  }
+  guint32 *keyword_ids = g_new(guint32, MAX(from->keywords->keywords->len, 1));
+  for (guint i = 0; i < from->keywords->keywords->len; ++i) {
+    keyword_ids[i] = keyword_dictionary_add(
+        table->keywords, keyword_dictionary_get(from->keywords, i));
+  }
+
+  emoji_table_reserve(table, table->len + from->len);
+  guint32 strings_base = table->strings_length;
+  memcpy(grow((void **)&table->strings, &table->strings_allocated,
+              table->strings_length, from->strings_length, 1),
+         from->strings, from->strings_length);
+  table->strings_length += from->strings_length;
+
+  guint32 keywords_base = table->keyword_offsets[table->len];
+  guint32 keyword_count = from->keyword_offsets[from->len];
+  guint32 *to_keyword_ids =
+      grow((void **)&table->keyword_ids, &table->keyword_ids_allocated,
+           keywords_base, keyword_count, sizeof(guint32));
+  for (guint32 i = 0; i < keyword_count; ++i) {
+    to_keyword_ids[i] = keyword_ids[from->keyword_ids[i]];
+  }
+
+  for (unsigned int row = 0; row < from->len; ++row) {
+    unsigned int to = table->len + row;
+    table->bytes[to] = strings_base + from->bytes[row];
+    table->names[to] = strings_base + from->names[row];
+    table->group_ids[to] = group_ids[from->group_ids[row]];
+    table->subgroup_ids[to] = subgroup_ids[from->subgroup_ids[row]];
+    table->keyword_offsets[to + 1] =
+        keywords_base + from->keyword_offsets[row + 1];
+  }
+  table->len += from->len;
+
+  g_free(group_ids);
+  g_free(subgroup_ids);
+  g_free(keyword_ids);
+}
+
+// Returns the ID of `str` in `strings`, adding it if it has not been seen
+// before. New strings are copied into `arena`, or stored as they are if it is
+// NULL, in which case they must live as long as the table.
+static unsigned int intern(GPtrArray *strings, GHashTable *ids, char *str,
+                           Arena *arena) {
+  gpointer id;
+  if (g_hash_table_lookup_extended(ids, str, NULL, &id)) {
+    return GPOINTER_TO_UINT(id);
+  }
+
+  if (arena != NULL) {
+    str = arena_strdup(arena, str);
+  }
+  unsigned int new_id = strings->len;
+  g_ptr_array_add(strings, str);
+  g_hash_table_insert(ids, str, GUINT_TO_POINTER(new_id));
+  return new_id;
+}
+
+unsigned int emoji_table_intern_group(EmojiTable *table, char *group) {
+  return intern(table->groups, table->group_ids_by_name, group, NULL);
+}
+
+unsigned int emoji_table_intern_subgroup(EmojiTable *table, char *subgroup) {
+  return intern(table->subgroups, table->subgroup_ids_by_name, subgroup,
+                NULL);
+}
+
+/*
+ * Like `emoji_table_intern_group()`, but copies new groups into the table's
+ * arena.
+ */
+unsigned int emoji_table_add_group(EmojiTable *table, const char *group) {
+  return intern(table->groups, table->group_ids_by_name, (char *)group,
+                table->arena);
+}
+
+unsigned int emoji_table_add_subgroup(EmojiTable *table,
+                                      const char *subgroup) {
+  return intern(table->subgroups, table->subgroup_ids_by_name,
+                (char *)subgroup, table->arena);
 }
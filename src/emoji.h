@@ -1,17 +1,99 @@
 #ifndef EMOJI_H
 #define EMOJI_H
 
-typedef struct Emoji {
-  char *bytes;
-  char *name;
-  char *group;
-  char *subgroup;
-
-  char **keywords;
-} Emoji;
-
-Emoji *emoji_new(char *bytes, char *name, char *group, char *subgroup,
-                 char **keywords);
-void emoji_free(Emoji *emoji);
+#include <glib.h>
+
+#include "arena.h"
+#include "keywords.h"
+
+// A list of emojis, stored as one array per field that is indexed by row. Use
+// the `emoji_table_*()` accessors below to read the fields of a row.
+//
+// Strings are referred to by 32-bit offsets into `strings`, and the arrays
+// either belong to the table or point into the database the table was read
+// from. Either way they are released together with the table.
+typedef struct EmojiTable {
+  unsigned int len;
+  unsigned int allocated;
+
+  // Offsets of the emoji and its name in `strings`.
+  guint32 *bytes;
+  guint32 *names;
+  // Index of the group and subgroup in `groups` and `subgroups`.
+  guint32 *group_ids;
+  guint32 *subgroup_ids;
+  // The keyword IDs of row `r` are `keyword_ids[keyword_offsets[r]]` up to
+  // (but not including) `keyword_ids[keyword_offsets[r + 1]]`.
+  guint32 *keyword_offsets;
+  guint32 *keyword_ids;
+  gsize keyword_ids_allocated;
+
+  // NUL-terminated emojis and names, back to back.
+  char *strings;
+  gsize strings_length;
+  gsize strings_allocated;
+
+  // Distinct groups and subgroups, indexed by the IDs stored for each row.
+  GPtrArray *groups;
+  GPtrArray *subgroups;
+  GHashTable *group_ids_by_name;
+  GHashTable *subgroup_ids_by_name;
+  // The keywords of all emojis.
+  KeywordDictionary *keywords;
+
+  // Holds the groups and subgroups.
+  Arena *arena;
+  GBytes *database;
+} EmojiTable;
+
+EmojiTable *emoji_table_new(unsigned int reserved_size);
+EmojiTable *emoji_table_new_mapped(GBytes *database);
+void emoji_table_free(EmojiTable *table);
+
+void emoji_table_reserve(EmojiTable *table, unsigned int size);
+unsigned int emoji_table_add(EmojiTable *table, const char *bytes,
+                             const char *name, unsigned int group_id,
+                             unsigned int subgroup_id,
+                             const guint32 *keyword_ids,
+                             unsigned int keyword_count);
+void emoji_table_append(EmojiTable *table, const EmojiTable *from);
+
+unsigned int emoji_table_intern_group(EmojiTable *table, char *group);
+unsigned int emoji_table_intern_subgroup(EmojiTable *table, char *subgroup);
+unsigned int emoji_table_add_group(EmojiTable *table, const char *group);
+unsigned int emoji_table_add_subgroup(EmojiTable *table, const char *subgroup);
+
+static inline const char *emoji_table_bytes(const EmojiTable *table,
+                                            unsigned int row) {
+  return table->strings + table->bytes[row];
+}
+
+static inline const char *emoji_table_name(const EmojiTable *table,
+                                           unsigned int row) {
+  return table->strings + table->names[row];
+}
+
+static inline const char *emoji_table_group(const EmojiTable *table,
+                                            unsigned int row) {
+  return g_ptr_array_index(table->groups, table->group_ids[row]);
+}
+
+static inline const char *emoji_table_subgroup(const EmojiTable *table,
+                                               unsigned int row) {
+  return g_ptr_array_index(table->subgroups, table->subgroup_ids[row]);
+}
+
+static inline unsigned int emoji_table_keyword_count(const EmojiTable *table,
+                                                     unsigned int row) {
+  return table->keyword_offsets[row + 1] - table->keyword_offsets[row];
+}
+
+static inline const char *emoji_table_keyword(const EmojiTable *table,
+                                              unsigned int row,
+                                              unsigned int index) {
+  return keyword_dictionary_get(
+      table->keywords,
+      table->keyword_ids[table->keyword_offsets[row] + index]);
+}
 
 #endif // EMOJI_H
@@ -1,54 +1,345 @@
 #include <glib.h>
-#include <rofi/helper.h>
+#include <string.h>
 
-#include "emoji.h"
+#include "formatter.h"
 #include "utils.h"
 
-char *new_format_entry(const char *text) {
-  if (text == NULL) {
-    return NULL;
+// Format strings follow the same rules as Rofi's
+// `helper_string_replace_if_exists`:
+//
+// - `{field}` is replaced with the markup-escaped value of the field, or with
+//   nothing if the field is empty or unknown.
+// - `[prefix{field}suffix]` is replaced with the prefix, value and suffix when
+//   the field has a value, and removed entirely when it does not. A section
+//   ends at the first `]` after its field and cannot span multiple lines.
+//   Like in Rofi, any Unicode line break ends a line.
+//
+// Rather than running that replacement for every rendered line, a format is
+// compiled once into a list of operations. Rendering then only computes the
+// fields that are actually referenced and writes them straight into a single
+// output buffer.
+
+typedef enum {
+  FIELD_EMOJI,
+  FIELD_NAME,
+  FIELD_GROUP,
+  FIELD_SUBGROUP,
+  FIELD_KEYWORDS,
+  FIELD_CODEPOINT,
+  FIELD_UNKNOWN,
+} FormatField;
+
+static const char *FIELD_NAMES[] = {"emoji",    "name",     "group",
+                                    "subgroup", "keywords", "codepoint"};
+
+typedef enum {
+  OP_LITERAL,
+  OP_FIELD,
+  OP_SECTION,
+} FormatOpType;
+
+typedef struct {
+  FormatOpType type;
+  FormatField field;
+  // The text for OP_LITERAL, and the text around the field for OP_SECTION.
+  char *prefix;
+  char *suffix;
+} FormatOp;
+
+struct EmojiFormat {
+  GArray *ops;
+  gsize size_hint;
+};
+
+static FormatField lookup_field(const char *name, gsize length) {
+  for (int i = 0; i < G_N_ELEMENTS(FIELD_NAMES); ++i) {
+    if (strlen(FIELD_NAMES[i]) == length &&
+        strncmp(FIELD_NAMES[i], name, length) == 0) {
+      return i;
+    }
+  }
+  return FIELD_UNKNOWN;
+}
+
+// Returns the length of a `{field}` placeholder starting at `p`, or 0 if there
+// is none. Field names are made out of word characters and dashes.
+static gsize placeholder_length(const char *p) {
+  if (*p != '{') {
+    return 0;
+  }
+
+  const char *c = p + 1;
+  while (*c != '}') {
+    gunichar ch = g_utf8_get_char_validated(c, -1);
+    if (ch == (gunichar)-1 || ch == (gunichar)-2) {
+      return 0;
+    }
+    if (ch != '_' && ch != '-' && !g_unichar_isalnum(ch)) {
+      return 0;
+    }
+    c = g_utf8_next_char(c);
+  }
+
+  if (c == p + 1) {
+    return 0;
+  }
+  return c - p + 1;
+}
+
+static int is_line_break(const char *p) {
+  switch ((unsigned char)p[0]) {
+  case '\n':
+  case '\r':
+  case '\v':
+  case '\f':
+    return TRUE;
+  case 0xc2: // U+0085 NEXT LINE
+    return (unsigned char)p[1] == 0x85;
+  case 0xe2: // U+2028 LINE SEPARATOR and U+2029 PARAGRAPH SEPARATOR
+    return (unsigned char)p[1] == 0x80 &&
+           ((unsigned char)p[2] == 0xa8 || (unsigned char)p[2] == 0xa9);
+  default:
+    return FALSE;
   }
+}
 
-  if (strlen(text) == 0) {
-    return NULL;
+// Parses a `[prefix{field}suffix]` section starting at `p` into `op`. Returns
+// the length of the section, or 0 if `p` does not start a section.
+static gsize parse_section(const char *p, FormatOp *op) {
+  if (*p != '[') {
+    return 0;
   }
 
-  char *escaped = g_markup_escape_text(text, -1);
+  for (const char *c = p + 1; *c != '\0' && !is_line_break(c); ++c) {
+    gsize length = placeholder_length(c);
+    if (length == 0) {
+      continue;
+    }
+
+    const char *end = c + length;
+    const char *close = end;
+    while (*close != '\0' && !is_line_break(close) && *close != ']') {
+      close++;
+    }
+    if (*close != ']') {
+      // No later field could be closed on this line either.
+      return 0;
+    }
+
+    op->type = OP_SECTION;
+    op->field = lookup_field(c + 1, length - 2);
+    op->prefix = g_strndup(p + 1, c - (p + 1));
+    op->suffix = g_strndup(end, close - end);
+    return close - p + 1;
+  }
 
-  return escaped;
+  return 0;
 }
 
-char *format_emoji(const Emoji *emoji, const char *format) {
-  char *bytes = new_format_entry(emoji->bytes);
-  char *name = new_format_entry(emoji->name);
-  char *group = new_format_entry(emoji->group);
-  char *subgroup = new_format_entry(emoji->subgroup);
+static void flush_literal(EmojiFormat *format, GString *literal) {
+  if (literal->len == 0) {
+    return;
+  }
+
+  FormatOp op = {
+      .type = OP_LITERAL,
+      .field = FIELD_UNKNOWN,
+      .prefix = g_strndup(literal->str, literal->len),
+      .suffix = NULL,
+  };
+  g_array_append_val(format->ops, op);
+  g_string_truncate(literal, 0);
+}
 
-  char *keywords_str = g_strjoinv(", ", emoji->keywords);
-  char *keywords_entry = new_format_entry(keywords_str);
-  g_free(keywords_str);
+/*
+ * Compiles a format string for repeated rendering. Free it with
+ * `emoji_format_free`.
+ */
+EmojiFormat *emoji_format_new(const char *format) {
+  EmojiFormat *compiled = g_new(EmojiFormat, 1);
+  compiled->ops = g_array_new(FALSE, FALSE, sizeof(FormatOp));
+  compiled->size_hint = strlen(format);
 
-  char *cp = codepoint(emoji->bytes);
+  GString *literal = g_string_new("");
+  const char *p = format;
 
-  // clang-format off
-  char *formatted = helper_string_replace_if_exists(
-    (char *) format, // LOL C. "trust me bro"
-    "{emoji}", bytes,
-    "{name}", name,
-    "{group}", group,
-    "{subgroup}", subgroup,
-    "{keywords}", keywords_entry,
-    "{codepoint}", cp,
-    NULL
-  );
-  // clang-format on
+  while (*p != '\0') {
+    FormatOp op;
+    gsize length = parse_section(p, &op);
+    if (length == 0 && (length = placeholder_length(p)) > 0) {
+      op.type = OP_FIELD;
+      op.field = lookup_field(p + 1, length - 2);
+      op.prefix = NULL;
+      op.suffix = NULL;
+    }
 
-  g_free(bytes);
-  g_free(name);
-  g_free(group);
-  g_free(subgroup);
-  g_free(keywords_entry);
-  g_free(cp);
+    if (length == 0) {
+      g_string_append_c(literal, *p);
+      p++;
+      continue;
+    }
+
+    flush_literal(compiled, literal);
+    g_array_append_val(compiled->ops, op);
+    compiled->size_hint += 32;
+    p += length;
+  }
+
+  flush_literal(compiled, literal);
+  g_string_free(literal, TRUE);
+
+  return compiled;
+}
+
+void emoji_format_free(EmojiFormat *format) {
+  if (format == NULL) {
+    return;
+  }
+
+  for (guint i = 0; i < format->ops->len; ++i) {
+    FormatOp *op = &g_array_index(format->ops, FormatOp, i);
+    g_free(op->prefix);
+    g_free(op->suffix);
+  }
+  g_array_free(format->ops, TRUE);
+  g_free(format);
+}
+
+// Appends `text` escaped for markup. Produces the same output as
+// `g_markup_escape_text`, without allocating for the common case of text that
+// has nothing to escape.
+static void append_escaped(GString *out, const char *text) {
+  for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; ++c) {
+    // 0xc2 starts the C1 control characters, which are escaped as well.
+    if (*c == '&' || *c == '<' || *c == '>' || *c == '\'' || *c == '"' ||
+        *c < 0x20 || *c == 0x7f || *c == 0xc2) {
+      char *escaped = g_markup_escape_text(text, -1);
+      g_string_append(out, escaped);
+      g_free(escaped);
+      return;
+    }
+  }
+
+  g_string_append(out, text);
+}
+
+static int is_empty(const char *text) { return text == NULL || *text == '\0'; }
+
+static int field_is_empty(const EmojiTable *table, unsigned int row,
+                          FormatField field) {
+  switch (field) {
+  case FIELD_EMOJI:
+    return is_empty(emoji_table_bytes(table, row));
+  case FIELD_CODEPOINT:
+    // Like Rofi, an empty codepoint still renders its section.
+    return FALSE;
+  case FIELD_NAME:
+    return is_empty(emoji_table_name(table, row));
+  case FIELD_GROUP:
+    return is_empty(emoji_table_group(table, row));
+  case FIELD_SUBGROUP:
+    return is_empty(emoji_table_subgroup(table, row));
+  case FIELD_KEYWORDS: {
+    // Keywords are joined with ", ", which is only empty for a single empty
+    // keyword.
+    unsigned int count = emoji_table_keyword_count(table, row);
+    return count == 0 ||
+           (count == 1 && is_empty(emoji_table_keyword(table, row, 0)));
+  }
+  default:
+    return TRUE;
+  }
+}
+
+static void append_field(GString *out, const EmojiTable *table,
+                         unsigned int row, FormatField field) {
+  if (field_is_empty(table, row, field)) {
+    return;
+  }
+
+  switch (field) {
+  case FIELD_EMOJI:
+    append_escaped(out, emoji_table_bytes(table, row));
+    break;
+  case FIELD_NAME:
+    append_escaped(out, emoji_table_name(table, row));
+    break;
+  case FIELD_GROUP:
+    append_escaped(out, emoji_table_group(table, row));
+    break;
+  case FIELD_SUBGROUP:
+    append_escaped(out, emoji_table_subgroup(table, row));
+    break;
+  case FIELD_KEYWORDS:
+    for (unsigned int i = 0; i < emoji_table_keyword_count(table, row); ++i) {
+      if (i > 0) {
+        g_string_append(out, ", ");
+      }
+      append_escaped(out, emoji_table_keyword(table, row, i));
+    }
+    break;
+  case FIELD_CODEPOINT:
+    // Codepoints never contain anything that needs escaping.
+    append_codepoint(out, emoji_table_bytes(table, row));
+    break;
+  default:
+    break;
+  }
+}
+
+char *emoji_format_render(const EmojiFormat *format, const EmojiTable *table,
+                          unsigned int row) {
+  GString *out = g_string_sized_new(format->size_hint);
+
+  for (guint i = 0; i < format->ops->len; ++i) {
+    const FormatOp *op = &g_array_index(format->ops, FormatOp, i);
+
+    switch (op->type) {
+    case OP_LITERAL:
+      g_string_append(out, op->prefix);
+      break;
+    case OP_FIELD:
+      append_field(out, table, row, op->field);
+      break;
+    case OP_SECTION:
+      if (!field_is_empty(table, row, op->field)) {
+        g_string_append(out, op->prefix);
+        append_field(out, table, row, op->field);
+        g_string_append(out, op->suffix);
+      }
+      break;
+    }
+  }
+
+  return g_string_free(out, FALSE);
+}
+
+/*
+ * Formats a single emoji of the table. Prefer compiling the format with
+ * `emoji_format_new` when rendering many emojis with the same format.
+ */
+char *format_emoji(const EmojiTable *table, unsigned int row,
+                   const char *format) {
+  EmojiFormat *compiled = emoji_format_new(format);
+  char *formatted = emoji_format_render(compiled, table, row);
+  emoji_format_free(compiled);
 
   return formatted;
 }
+
+/*
+ * Returns the "{emoji} {name} {keywords}" string of every row, which is what
+ * queries are matched against, in a NULL-terminated array.
+ */
+char **generate_matcher_strings(const EmojiTable *table) {
+  EmojiFormat *format = emoji_format_new("{emoji} {name} {keywords}");
+
+  char **strings = g_new(char *, table->len + 1);
+  for (int i = 0; i < table->len; ++i) {
+    strings[i] = emoji_format_render(format, table, i);
+  }
+  strings[table->len] = NULL;
+
+  emoji_format_free(format);
+  return strings;
+}
@@ -3,6 +3,16 @@
 
 #include "emoji.h"
 
-char *format_emoji(const Emoji *emoji, const char *format);
+typedef struct EmojiFormat EmojiFormat;
+
+EmojiFormat *emoji_format_new(const char *format);
+void emoji_format_free(EmojiFormat *format);
+char *emoji_format_render(const EmojiFormat *format, const EmojiTable *table,
+                          unsigned int row);
+
+char *format_emoji(const EmojiTable *table, unsigned int row,
+                   const char *format);
+
+char **generate_matcher_strings(const EmojiTable *table);
 
 #endif // FORMATTER_H
@@ -0,0 +1,127 @@
+#include <glib.h>
+#include <string.h>
+
+#include "keywords.h"
+#include "utils.h"
+
+// Words like "face" or "hand" are keywords of hundreds of emojis. Storing
+// them once and referring to them by a 32-bit ID keeps the keywords of a
+// table small.
+
+// Keywords are found through an open addressing hash table of their hashes
+// and IDs, which is kept at most half full.
+#define INITIAL_SLOTS 64
+
+KeywordDictionary *keyword_dictionary_new(void) {
+  KeywordDictionary *dictionary = g_new(KeywordDictionary, 1);
+  dictionary->keywords = g_ptr_array_new();
+  dictionary->slots = g_new0(KeywordSlot, INITIAL_SLOTS);
+  dictionary->slot_mask = INITIAL_SLOTS - 1;
+  dictionary->hashed = 0;
+  dictionary->arena = arena_new();
+  return dictionary;
+}
+
+void keyword_dictionary_free(KeywordDictionary *dictionary) {
+  if (dictionary == NULL) {
+    return;
+  }
+
+  g_ptr_array_free(dictionary->keywords, TRUE);
+  g_free(dictionary->slots);
+  arena_free(dictionary->arena);
+  g_free(dictionary);
+}
+
+// Doubles the number of slots, putting every keyword into its new slot.
+static void grow_slots(KeywordDictionary *dictionary) {
+  guint32 mask = dictionary->slot_mask * 2 + 1;
+  KeywordSlot *slots = g_new0(KeywordSlot, mask + 1);
+  for (guint32 i = 0; i <= dictionary->slot_mask; ++i) {
+    KeywordSlot slot = dictionary->slots[i];
+    if (slot.keyword != NULL) {
+      guint32 index = slot.hash & mask;
+      while (slots[index].keyword != NULL) {
+        index = (index + 1) & mask;
+      }
+      slots[index] = slot;
+    }
+  }
+
+  g_free(dictionary->slots);
+  dictionary->slots = slots;
+  dictionary->slot_mask = mask;
+}
+
+// Returns the slot of `keyword`, or the empty slot it belongs in.
+static KeywordSlot *find_slot(const KeywordDictionary *dictionary,
+                              const char *keyword, guint32 hash) {
+  guint32 index = hash & dictionary->slot_mask;
+  for (;;) {
+    KeywordSlot *slot = &dictionary->slots[index];
+    if (slot->keyword == NULL ||
+        (slot->hash == hash && strcmp(slot->keyword, keyword) == 0)) {
+      return slot;
+    }
+    index = (index + 1) & dictionary->slot_mask;
+  }
+}
+
+static void insert_slot(KeywordDictionary *dictionary, KeywordSlot *slot,
+                        const char *keyword, guint32 hash, guint32 id) {
+  *slot = (KeywordSlot){keyword, hash, id};
+  dictionary->hashed++;
+  if (dictionary->hashed * 2 > dictionary->slot_mask) {
+    grow_slots(dictionary);
+  }
+}
+
+/*
+ * Returns the ID of `keyword`, adding a copy of it to the dictionary if it has
+ * not been seen before.
+ */
+guint32 keyword_dictionary_add(KeywordDictionary *dictionary,
+                               const char *keyword) {
+  // Catch up on the keywords that were appended without hashing them.
+  while (dictionary->hashed < dictionary->keywords->len) {
+    guint32 id = dictionary->hashed;
+    const char *other = keyword_dictionary_get(dictionary, id);
+    guint32 hash = hash_string(other);
+    KeywordSlot *slot = find_slot(dictionary, other, hash);
+    if (slot->keyword == NULL) {
+      insert_slot(dictionary, slot, other, hash, id);
+    } else {
+      // Duplicates keep their own ID, but are found by the first one.
+      dictionary->hashed++;
+    }
+  }
+
+  guint32 hash = hash_string(keyword);
+  KeywordSlot *slot = find_slot(dictionary, keyword, hash);
+  if (slot->keyword != NULL) {
+    return slot->id;
+  }
+
+  char *stored = arena_strdup(dictionary->arena, keyword);
+  guint32 new_id = dictionary->keywords->len;
+  g_ptr_array_add(dictionary->keywords, stored);
+  insert_slot(dictionary, slot, stored, hash, new_id);
+  return new_id;
+}
+
+/*
+ * Adds `keyword` under a new ID without copying it, and without checking if it
+ * is already in the dictionary. Meant for keywords that are known to be
+ * distinct, like the ones of a compiled database, which then do not need to
+ * be hashed unless more keywords are added.
+ */
+guint32 keyword_dictionary_append(KeywordDictionary *dictionary,
+                                  const char *keyword) {
+  g_ptr_array_add(dictionary->keywords, (char *)keyword);
+  return dictionary->keywords->len - 1;
+}
+
+const char *keyword_dictionary_get(const KeywordDictionary *dictionary,
+                                   guint32 id) {
+  return g_ptr_array_index(dictionary->keywords, id);
+}
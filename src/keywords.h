@@ -0,0 +1,39 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <glib.h>
+
+#include "arena.h"
+
+typedef struct {
+  // NULL for empty slots.
+  const char *keyword;
+  guint32 hash;
+  guint32 id;
+} KeywordSlot;
+
+// Every distinct keyword of an emoji table, stored once and identified by a
+// keyword ID. Emojis refer to their keywords by ID.
+typedef struct KeywordDictionary {
+  // Keywords indexed by ID, and a hash table to find the ID of a keyword.
+  GPtrArray *keywords;
+  KeywordSlot *slots;
+  guint32 slot_mask;
+  // Keywords with a lower ID are in `slots`. The others are added to it when
+  // they are needed.
+  guint32 hashed;
+  // Owns the keywords that were copied into the dictionary.
+  Arena *arena;
+} KeywordDictionary;
+
+KeywordDictionary *keyword_dictionary_new(void);
+void keyword_dictionary_free(KeywordDictionary *dictionary);
+
+guint32 keyword_dictionary_add(KeywordDictionary *dictionary,
+                               const char *keyword);
+guint32 keyword_dictionary_append(KeywordDictionary *dictionary,
+                                  const char *keyword);
+const char *keyword_dictionary_get(const KeywordDictionary *dictionary,
+                                   guint32 id);
+
+#endif // KEYWORDS_H
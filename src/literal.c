@@ -0,0 +1,332 @@
+#include <glib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "literal.h"
+
+// Matches plain literal tokens without going through the regex engine. All
+// strings are stored back to back, once as-is and once with ASCII letters
+// lowercased, so that a run of rows can be searched with a single pass over
+// memory.
+//
+// Only literals for which the result is guaranteed to be the same as Rofi's
+// regex match are supported; the caller falls back to the regex for the rest.
+
+// Searching may read this far past the end of the haystack.
+#define SEARCH_PADDING 16
+
+struct LiteralMatcher {
+  // NUL-separated strings, followed by SEARCH_PADDING zero bytes.
+  char *original;
+  char *folded;
+  // Offset of the start of every string, plus one for the end of the last.
+  guint32 *offsets;
+  unsigned int count;
+  // See `trigram.c`; caseless matching makes "k" and "s" match non-ASCII
+  // characters.
+  gboolean has_case_exceptions;
+  // Regex matching never matches invalid UTF-8.
+  gboolean valid_utf8;
+  // The data the strings point into, or NULL if they belong to the matcher.
+  GBytes *mapping;
+};
+
+// How `literal_matcher_write()` stores a matcher. It is followed by the
+// offsets, and then by both copies of the strings with their padding.
+typedef struct {
+  guint32 count;
+  guint32 size;
+  guint32 has_case_exceptions;
+  guint32 valid_utf8;
+} LiteralMatcherHeader;
+
+LiteralMatcher *literal_matcher_new(char *const *strings, unsigned int count) {
+  LiteralMatcher *matcher = g_new(LiteralMatcher, 1);
+  matcher->offsets = g_new(guint32, count + 1);
+  matcher->count = count;
+  matcher->has_case_exceptions = FALSE;
+  matcher->valid_utf8 = TRUE;
+  matcher->mapping = NULL;
+
+  gsize size = 0;
+  for (unsigned int row = 0; row < count; ++row) {
+    matcher->offsets[row] = size;
+    size += strlen(strings[row]) + 1;
+  }
+  matcher->offsets[count] = size;
+
+  matcher->original = g_malloc0(size + SEARCH_PADDING);
+  matcher->folded = g_malloc0(size + SEARCH_PADDING);
+
+  for (unsigned int row = 0; row < count; ++row) {
+    const char *str = strings[row];
+    char *original = matcher->original + matcher->offsets[row];
+    char *folded = matcher->folded + matcher->offsets[row];
+    gsize length = matcher->offsets[row + 1] - matcher->offsets[row];
+
+    memcpy(original, str, length);
+    for (gsize i = 0; i < length; ++i) {
+      folded[i] = g_ascii_tolower(str[i]);
+    }
+
+    if (strstr(str, "\xe2\x84\xaa") != NULL ||
+        strstr(str, "\xc5\xbf") != NULL) {
+      matcher->has_case_exceptions = TRUE;
+    }
+    if (!g_utf8_validate(str, -1, NULL)) {
+      matcher->valid_utf8 = FALSE;
+    }
+  }
+
+  return matcher;
+}
+
+void literal_matcher_free(LiteralMatcher *matcher) {
+  if (matcher == NULL) {
+    return;
+  }
+
+  if (matcher->mapping != NULL) {
+    g_bytes_unref(matcher->mapping);
+  } else {
+    g_free(matcher->original);
+    g_free(matcher->folded);
+    g_free(matcher->offsets);
+  }
+  g_free(matcher);
+}
+
+/*
+ * Appends the matcher to `out` in a form that `literal_matcher_map()` can use
+ * without copying the strings again.
+ */
+void literal_matcher_write(const LiteralMatcher *matcher, GString *out) {
+  LiteralMatcherHeader header = {
+      .count = matcher->count,
+      .size = matcher->offsets[matcher->count],
+      .has_case_exceptions = matcher->has_case_exceptions,
+      .valid_utf8 = matcher->valid_utf8,
+  };
+  g_string_append_len(out, (const char *)&header, sizeof(header));
+  g_string_append_len(out, (const char *)matcher->offsets,
+                      (header.count + 1) * sizeof(guint32));
+  g_string_append_len(out, matcher->original, header.size + SEARCH_PADDING);
+  g_string_append_len(out, matcher->folded, header.size + SEARCH_PADDING);
+}
+
+/*
+ * Uses the `length` bytes at `offset` in `bytes`, written by
+ * `literal_matcher_write()`, as a matcher. The strings are not copied, and the
+ * matcher keeps a reference to `bytes`.
+ *
+ * Returns NULL if the data is invalid, or does not hold `count` strings.
+ */
+LiteralMatcher *literal_matcher_map(GBytes *bytes, gsize offset, gsize length,
+                                    unsigned int count) {
+  gsize size;
+  const char *data = g_bytes_get_data(bytes, &size);
+  if (data == NULL || offset % sizeof(guint32) != 0 || offset + length > size ||
+      length < sizeof(LiteralMatcherHeader)) {
+    return NULL;
+  }
+
+  const LiteralMatcherHeader *header =
+      (const LiteralMatcherHeader *)(data + offset);
+  if (header->count != count ||
+      (guint64)sizeof(LiteralMatcherHeader) +
+          ((guint64)header->count + 1) * sizeof(guint32) +
+          ((guint64)header->size + SEARCH_PADDING) * 2 !=
+      length) {
+    return NULL;
+  }
+
+  const guint32 *offsets = (const guint32 *)(header + 1);
+  const char *original = (const char *)(offsets + header->count + 1);
+  const char *folded = original + header->size + SEARCH_PADDING;
+
+  // Every string ends with a NUL byte, and searching past the last one only
+  // ever finds the zeroed padding.
+  if (offsets[0] != 0 || offsets[header->count] != header->size) {
+    return NULL;
+  }
+  for (guint32 row = 0; row < header->count; ++row) {
+    if (offsets[row] >= offsets[row + 1] ||
+        original[offsets[row + 1] - 1] != '\0' ||
+        folded[offsets[row + 1] - 1] != '\0') {
+      return NULL;
+    }
+  }
+  for (gsize i = 0; i < SEARCH_PADDING; ++i) {
+    if (original[header->size + i] != '\0' ||
+        folded[header->size + i] != '\0') {
+      return NULL;
+    }
+  }
+
+  LiteralMatcher *matcher = g_new(LiteralMatcher, 1);
+  matcher->original = (char *)original;
+  matcher->folded = (char *)folded;
+  matcher->offsets = (guint32 *)offsets;
+  matcher->count = header->count;
+  matcher->has_case_exceptions = header->has_case_exceptions;
+  matcher->valid_utf8 = header->valid_utf8;
+  matcher->mapping = g_bytes_ref(bytes);
+  return matcher;
+}
+
+/*
+ * Returns the string stored for `row`. It stays valid for as long as the
+ * matcher.
+ */
+const char *literal_matcher_string(const LiteralMatcher *matcher,
+                                   unsigned int row) {
+  return matcher->original + matcher->offsets[row];
+}
+
+/*
+ * Returns TRUE if `literal_matcher_filter` gives the same result as a regex
+ * search for the escaped literal would.
+ */
+gboolean literal_matcher_supports(const LiteralMatcher *matcher,
+                                  const char *literal, gboolean caseless) {
+  if (!matcher->valid_utf8) {
+    return FALSE;
+  }
+  if (!caseless) {
+    return TRUE;
+  }
+
+  // Lowercasing ASCII letters is only the same as ignoring case for literals
+  // made out of ASCII.
+  for (const char *c = literal; *c != '\0'; ++c) {
+    char lower = g_ascii_tolower(*c);
+    if ((guchar)*c >= 0x80 ||
+        (matcher->has_case_exceptions && (lower == 'k' || lower == 's'))) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// Returns the first occurrence of `needle` in the `length` bytes at
+// `haystack`, or NULL. Might read up to SEARCH_PADDING bytes past the end of
+// the haystack.
+static const char *find(const char *haystack, gsize length,
+                        const char *needle, gsize needle_length) {
+  if (needle_length > length) {
+    return NULL;
+  }
+
+#ifdef __SSE2__
+  // Compare 16 positions at once against the first and the last byte of the
+  // needle, and only compare the rest where both match.
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+  gsize end = length - needle_length + 1;
+
+  for (gsize i = 0; i < end; i += 16) {
+    __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+    __m128i block_last =
+        _mm_loadu_si128((const __m128i *)(haystack + i + needle_length - 1));
+    unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+
+    while (mask != 0) {
+      gsize position = i + __builtin_ctz(mask);
+      if (position >= end) {
+        return NULL;
+      }
+      if (needle_length <= 2 || memcmp(haystack + position + 1, needle + 1,
+                                        needle_length - 2) == 0) {
+        return haystack + position;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  return NULL;
+#else
+  const char *end = haystack + length - needle_length + 1;
+  for (const char *c = haystack; c < end; ++c) {
+    c = memchr(c, needle[0], end - c);
+    if (c == NULL) {
+      return NULL;
+    }
+    if (memcmp(c + 1, needle + 1, needle_length - 1) == 0) {
+      return c;
+    }
+  }
+  return NULL;
+#endif
+}
+
+// Applies the result for `row` to the set.
+static void apply(Bitset *rows, unsigned int row, gboolean contains,
+                  gboolean invert) {
+  if (contains == invert) {
+    bitset_clear(rows, row);
+  }
+}
+
+/*
+ * Keeps only the rows from `first` up to `last` in `rows` that contain
+ * `literal`, or that do not contain it if `invert` is set. Rows outside of
+ * that range are left alone. The literal must be supported, see
+ * `literal_matcher_supports`.
+ */
+void literal_matcher_filter(const LiteralMatcher *matcher, const char *literal,
+                            gboolean caseless, gboolean invert, Bitset *rows,
+                            unsigned int first, unsigned int last) {
+  last = MIN(last, rows->size);
+
+  gsize length = strlen(literal);
+  if (length == 0) {
+    // Every string contains the empty string.
+    for (unsigned int row = first; invert && row < last; ++row) {
+      bitset_clear(rows, row);
+    }
+    return;
+  }
+
+  const char *data = caseless ? matcher->folded : matcher->original;
+  char *needle = caseless ? g_ascii_strdown(literal, -1) : g_strdup(literal);
+
+  // Search every run of consecutive rows in one go. The strings are separated
+  // by NUL bytes, so a match can never span two rows.
+  unsigned int start = bitset_next_before(rows, first, last);
+  while (start < last) {
+    unsigned int end = start + 1;
+    while (end < last && bitset_get(rows, end)) {
+      end++;
+    }
+
+    unsigned int row = start;
+    const char *run_end = data + matcher->offsets[end];
+    const char *position = data + matcher->offsets[start];
+
+    while (row < end) {
+      const char *match = find(position, run_end - position, needle, length);
+      if (match == NULL) {
+        break;
+      }
+
+      gsize offset = match - data;
+      while (matcher->offsets[row + 1] <= offset) {
+        apply(rows, row++, FALSE, invert);
+      }
+      apply(rows, row++, TRUE, invert);
+      position = data + matcher->offsets[row];
+    }
+
+    while (row < end) {
+      apply(rows, row++, FALSE, invert);
+    }
+
+    start = bitset_next_before(rows, end, last);
+  }
+
+  g_free(needle);
+}
@@ -0,0 +1,26 @@
+#ifndef LITERAL_H
+#define LITERAL_H
+
+#include <glib.h>
+
+#include "bitset.h"
+
+typedef struct LiteralMatcher LiteralMatcher;
+
+LiteralMatcher *literal_matcher_new(char *const *strings, unsigned int count);
+void literal_matcher_free(LiteralMatcher *matcher);
+
+void literal_matcher_write(const LiteralMatcher *matcher, GString *out);
+LiteralMatcher *literal_matcher_map(GBytes *bytes, gsize offset, gsize length,
+                                    unsigned int count);
+
+const char *literal_matcher_string(const LiteralMatcher *matcher,
+                                   unsigned int row);
+
+gboolean literal_matcher_supports(const LiteralMatcher *matcher,
+                                  const char *literal, gboolean caseless);
+void literal_matcher_filter(const LiteralMatcher *matcher, const char *literal,
+                            gboolean caseless, gboolean invert, Bitset *rows,
+                            unsigned int first, unsigned int last);
+
+#endif // LITERAL_H
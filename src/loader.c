@@ -4,168 +4,349 @@
 #include <string.h>
 
 #include "loader.h"
+#include "scanner.h"
 #include "utils.h"
 
-#define MAX_LINE_LENGTH 1024
+// Smaller files are parsed faster than threads can be started.
+#define PARALLEL_MIN_CHUNK_SIZE (256 * 1024)
 
-// Copies the text from the `input` string up until (but not including) the
-// next `until` character into a newly allocated buffer at `result`. You need
-// to free `result` when you are done with it.
-//
-// Returns the position in the input string after the `until` character.
-//
-// If `until` could not be found in `string`, it will not advance and `result`
-// will be set to `NULL`.
-const char *scan_until(const char until, const char *input, char **result) {
-  char *index = strchr(input, until);
+// Strips whitespace from both ends of the text between `start` and `end`, and
+// ends it with a NUL byte in place. Returns the start of the stripped text.
+static char *finish_field(char *start, char *end, gboolean capitalized) {
+  while (start < end && g_ascii_isspace(*start)) {
+    start++;
+  }
+  while (end > start && g_ascii_isspace(end[-1])) {
+    end--;
+  }
+  *end = '\0';
 
-  if (index == NULL) {
-    *result = NULL;
-    return input;
+  if (capitalized) {
+    capitalize(start);
   }
+  return start;
+}
 
-  int length = (index - input);
-  *result = g_strndup(input, length);
+static int is_ascii(const char *str) {
+  for (; *str != '\0'; ++str) {
+    if ((unsigned char)*str >= 0x80) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// Compares two strings without regard to case. Plain ASCII strings, which is
+// almost all of them, are compared without allocating casefolded copies.
+static int casefold_equal(const char *a, const char *b) {
+  if (is_ascii(a) && is_ascii(b)) {
+    return g_ascii_strcasecmp(a, b) == 0;
+  }
 
-  // Advance input to character after the `until` character.
-  return index + 1;
+  char *a_casefold = g_utf8_casefold(a, -1);
+  char *b_casefold = g_utf8_casefold(b, -1);
+  int equal = strcmp(a_casefold, b_casefold) == 0;
+  g_free(a_casefold);
+  g_free(b_casefold);
+  return equal;
 }
 
-void array_emoji_free_item(gpointer item) { emoji_free(item); }
+// Most emojis have fewer keywords than this, and their keywords are collected
+// without allocating. Reuse the same `Fields` for many lines to not allocate
+// for the others either.
+#define LINE_KEYWORDS 64
+
+// The fields of a line, pointing into the line itself.
+typedef struct {
+  char *bytes;
+  char *group;
+  char *subgroup;
+  char *name;
+  char **keywords;
+  unsigned int keyword_count;
+  unsigned int keywords_allocated;
+  char *line_keywords[LINE_KEYWORDS];
+  // A copy of the line being split, and the IDs of its keywords in a table.
+  // Both are grown as needed.
+  char *line;
+  gsize line_allocated;
+  guint32 *keyword_ids;
+  unsigned int keyword_ids_allocated;
+} Fields;
+
+static void fields_init(Fields *fields) {
+  fields->keywords = fields->line_keywords;
+  fields->keyword_count = 0;
+  fields->keywords_allocated = LINE_KEYWORDS;
+  fields->line = NULL;
+  fields->line_allocated = 0;
+  fields->keyword_ids = NULL;
+  fields->keyword_ids_allocated = 0;
+}
 
-GPtrArray *read_emojis_from_file(const char *path) {
-  FILE *file = fopen(path, "r");
-  if (!file) {
-    return NULL;
+static void fields_clear_keywords(Fields *fields) {
+  if (fields->keywords != fields->line_keywords) {
+    g_free(fields->keywords);
   }
+}
 
-  char line[MAX_LINE_LENGTH];
+static void fields_clear(Fields *fields) {
+  fields_clear_keywords(fields);
+  g_free(fields->line);
+  g_free(fields->keyword_ids);
+}
 
-  GPtrArray *list = g_ptr_array_sized_new(512);
-  g_ptr_array_set_free_func(list, array_emoji_free_item);
+static void fields_add_keyword(Fields *fields, char *keyword) {
+  if (fields->keyword_count == fields->keywords_allocated) {
+    char **keywords = g_new(char *, fields->keywords_allocated * 2);
+    memcpy(keywords, fields->keywords, fields->keyword_count * sizeof(char *));
+    fields_clear_keywords(fields);
+    fields->keywords = keywords;
+    fields->keywords_allocated *= 2;
+  }
+  fields->keywords[fields->keyword_count++] = keyword;
+}
 
-  while (fgets(line, MAX_LINE_LENGTH, file) != NULL) {
-    Emoji *emoji = parse_emoji_from_line(line);
-    if (emoji == NULL) {
-      break;
+// Splits the first `length` bytes of `line` into its fields in place. Fields
+// are stripped, and all but the emoji are capitalized. Keywords that are the
+// same as the name are left out as they would just be redundant.
+//
+// Returns FALSE if the line does not have all fields.
+static gboolean split_line(char *line, gsize length, Fields *fields) {
+  // Each line in the file has this format:
+  // [bytes]\t[group]\t[subgroup]\t[name]\t[keywords_str]\n
+  char **header[] = {&fields->bytes, &fields->group, &fields->subgroup,
+                     &fields->name};
+  fields->keyword_count = 0;
+
+  FieldScanner scanner;
+  field_scanner_init(&scanner, line, length);
+  const char *delimiter;
+  char *start = line;
+
+  for (unsigned int i = 0; i < G_N_ELEMENTS(header);) {
+    delimiter = field_scanner_next(&scanner);
+    if (delimiter == NULL || *delimiter == '\n' || *delimiter == '\0') {
+      return FALSE;
+    }
+    if (*delimiter == '\t') {
+      char *end = line + (delimiter - line);
+      *header[i] = finish_field(start, end, i > 0);
+      start = end + 1;
+      i++;
     }
-    g_ptr_array_add(list, emoji);
   }
 
-  fclose(file);
+  // Keywords are separated by pipes, and there might not be any.
+  gboolean empty = *start == '\n';
+  char separator;
+  do {
+    delimiter = field_scanner_next(&scanner);
+    if (delimiter == NULL || *delimiter == '\0') {
+      return FALSE;
+    }
+    // Finishing a keyword overwrites the separator after it.
+    separator = *delimiter;
+    if (separator == '|' || (separator == '\n' && !empty)) {
+      char *end = line + (delimiter - line);
+      char *keyword = finish_field(start, end, TRUE);
+      if (!casefold_equal(fields->name, keyword)) {
+        fields_add_keyword(fields, keyword);
+      }
+      start = end + 1;
+    }
+  } while (separator != '\n');
 
-  return list;
+  return TRUE;
 }
 
-void cleanup(char *str) {
-  g_strstrip(str);
-  capitalize(str);
-}
+// Parses the first `length` bytes of `line` and appends them to the table.
+// The line does not need to end with a newline.
+static gboolean parse_line_into_table(EmojiTable *table, const char *line,
+                                      gsize length, Fields *fields) {
+  if (length + 2 > fields->line_allocated) {
+    g_free(fields->line);
+    fields->line_allocated = MAX(length + 2, fields->line_allocated * 2);
+    fields->line = g_malloc(fields->line_allocated);
+  }
+  char *buffer = fields->line;
+  memcpy(buffer, line, length);
+  if (length == 0 || line[length - 1] != '\n') {
+    buffer[length++] = '\n';
+  }
+  buffer[length] = '\0';
 
-int scan_line(const char *line, char **bytes, char **name, char **group,
-              char **subgroup, char **keywords) {
-  *bytes = NULL;
-  *group = NULL;
-  *subgroup = NULL;
-  *name = NULL;
-  *keywords = NULL;
+  if (!split_line(buffer, length, fields)) {
+    return FALSE;
+  }
 
-  const char *cursor = line;
+  if (fields->keyword_count > fields->keyword_ids_allocated) {
+    g_free(fields->keyword_ids);
+    fields->keyword_ids_allocated =
+        MAX(fields->keyword_count, fields->keywords_allocated);
+    fields->keyword_ids = g_new(guint32, fields->keyword_ids_allocated);
+  }
+  for (unsigned int i = 0; i < fields->keyword_count; ++i) {
+    fields->keyword_ids[i] =
+        keyword_dictionary_add(table->keywords, fields->keywords[i]);
+  }
 
-  // Each line in the file has this format:
-  // [bytes]\t[group]\t[subgroup]\t[keywords_str]
-
-  cursor = scan_until('\t', cursor, bytes);
-  if (*bytes == NULL) {
-    return 0;
-  }
-  cursor = scan_until('\t', cursor, group);
-  if (*group == NULL) {
-    g_free(*bytes);
-    return 0;
-  }
-  cursor = scan_until('\t', cursor, subgroup);
-  if (*subgroup == NULL) {
-    g_free(*bytes);
-    g_free(*group);
-    return 0;
-  }
-  cursor = scan_until('\t', cursor, name);
-  if (*name == NULL) {
-    g_free(*bytes);
-    g_free(*group);
-    g_free(*subgroup);
-    return 0;
-  }
-  cursor = scan_until('\n', cursor, keywords);
-  if (*keywords == NULL) {
-    g_free(*bytes);
-    g_free(*group);
-    g_free(*subgroup);
-    g_free(*name);
-    return 0;
-  }
-
-  return 1;
+  emoji_table_add(table, fields->bytes, fields->name,
+                  emoji_table_add_group(table, fields->group),
+                  emoji_table_add_subgroup(table, fields->subgroup),
+                  fields->keyword_ids, fields->keyword_count);
+  return TRUE;
 }
 
-char **build_keyword_list(const char *keywords_str, const char *name) {
-  // Build keyword list. Skip entries that are identical to the name as they
-  // will just be redundant.
-  char *name_casefold = g_utf8_casefold(name, -1);
-  GPtrArray *kw_array = g_ptr_array_new();
-  char **keywords;
-
-  keywords = g_strsplit(keywords_str, "|", -1);
+/*
+ * Parses a line and appends it to the table. The line is split in a scratch
+ * buffer, and only the emoji and its name are copied into the table's
+ * strings. Groups, subgroups and keywords are stored once for the whole table.
+ *
+ * Returns FALSE if the line could not be parsed.
+ */
+gboolean parse_emoji_into_table(EmojiTable *table, const char *line) {
+  Fields fields;
+  fields_init(&fields);
+  gboolean parsed = parse_line_into_table(table, line, strlen(line), &fields);
+  fields_clear(&fields);
+  return parsed;
+}
 
-  for (int i = 0; keywords[i] != NULL; i++) {
-    char *keyword = keywords[i];
-    cleanup(keyword);
-    char *keyword_casefold = g_utf8_casefold(keyword, -1);
+// A newline-aligned part of an emoji file, parsed into a table of its own.
+typedef struct {
+  const char *start;
+  const char *end;
+  EmojiTable *table;
+  // Number of lines in the chunk, and the ones that could not be parsed,
+  // numbered from the start of the chunk.
+  unsigned int lines;
+  SkippedLines skipped;
+} Chunk;
+
+static void skipped_lines_add(SkippedLines *skipped, unsigned int line) {
+  if (skipped->count < MAX_REPORTED_LINES) {
+    skipped->lines[skipped->count] = line;
+  }
+  skipped->count++;
+}
 
-    if (strcmp(name_casefold, keyword_casefold) != 0) {
-      g_ptr_array_add(kw_array, g_strdup(keyword));
+static gpointer parse_chunk(gpointer data) {
+  Chunk *chunk = data;
+  chunk->table = emoji_table_new(512);
+  Fields fields;
+  fields_init(&fields);
+
+  const char *line = chunk->start;
+  while (line < chunk->end) {
+    const char *newline = memchr(line, '\n', chunk->end - line);
+    const char *next = newline != NULL ? newline + 1 : chunk->end;
+    chunk->lines++;
+
+    // Empty lines are allowed anywhere and are not worth reporting.
+    if (line != newline &&
+        !parse_line_into_table(chunk->table, line, next - line, &fields)) {
+      skipped_lines_add(&chunk->skipped, chunk->lines);
     }
-
-    g_free(keyword_casefold);
+    line = next;
   }
 
-  // Original keywords can now be freed and replaced with the built list (which
-  // is cleaned up and has no keywords equal to the name).
-  g_strfreev(keywords);
+  fields_clear(&fields);
+  return NULL;
+}
 
-  keywords = g_new(char *, kw_array->len + 1);
-  for (int i = 0; i < kw_array->len; i++) {
-    keywords[i] = g_strdup(g_ptr_array_index(kw_array, i));
-  }
-  keywords[kw_array->len] = NULL;
+// Appends the emojis of `chunk` to the end of `table`, and frees the chunk's
+// table.
+static void append_chunk(EmojiTable *table, Chunk *chunk) {
+  emoji_table_append(table, chunk->table);
+  emoji_table_free(chunk->table);
+  chunk->table = NULL;
+}
 
-  g_ptr_array_free(kw_array, TRUE);
-  g_free(name_casefold);
+/*
+ * Reads an emoji file, splitting it into `threads` parts that are parsed at
+ * the same time. The result is the same no matter the number of threads. With
+ * 0 threads, large files are parsed on one thread per processor.
+ *
+ * Lines of any length are read. Lines that cannot be parsed are skipped, and
+ * counted in `skipped` unless it is NULL.
+ *
+ * Returns NULL if the file cannot be read.
+ */
+EmojiTable *read_emojis_from_file_with_threads(const char *path,
+                                               unsigned int threads,
+                                               SkippedLines *skipped) {
+  GMappedFile *file = g_mapped_file_new(path, FALSE, NULL);
+  if (file == NULL) {
+    return NULL;
+  }
 
-  return keywords;
-}
+  const char *contents = g_mapped_file_get_contents(file);
+  gsize length = g_mapped_file_get_length(file);
+  const char *end = contents + length;
+  if (threads == 0) {
+    threads = MIN(g_get_num_processors(), length / PARALLEL_MIN_CHUNK_SIZE);
+  }
+  threads = MAX(threads, 1);
+
+  // Every chunk ends after a newline, or at the end of the file.
+  Chunk *chunks = g_new0(Chunk, threads);
+  const char *start = contents;
+  for (unsigned int i = 0; i < threads; ++i) {
+    const char *chunk_end = MAX(contents + length / threads * (i + 1), start);
+    if (i == threads - 1 || chunk_end >= end) {
+      chunk_end = end;
+    } else {
+      const char *newline = memchr(chunk_end, '\n', end - chunk_end);
+      chunk_end = newline != NULL ? newline + 1 : end;
+    }
 
-Emoji *parse_emoji_from_line(const char *line) {
-  const char *cursor = line;
+    chunks[i].start = start;
+    chunks[i].end = chunk_end;
+    start = chunk_end;
+  }
 
-  char *bytes = NULL;
-  char *group = NULL;
-  char *subgroup = NULL;
-  char *name = NULL;
-  char *keywords_str = NULL;
+  GThread **workers = g_new(GThread *, threads);
+  for (unsigned int i = 1; i < threads; ++i) {
+    workers[i] = g_thread_new("emoji-loader", parse_chunk, &chunks[i]);
+  }
+  parse_chunk(&chunks[0]);
+  for (unsigned int i = 1; i < threads; ++i) {
+    g_thread_join(workers[i]);
+  }
+  g_free(workers);
 
-  if (!scan_line(cursor, &bytes, &name, &group, &subgroup, &keywords_str)) {
-    return NULL;
+  EmojiTable *table = chunks[0].table;
+  if (threads > 1) {
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < threads; ++i) {
+      total += chunks[i].table->len;
+    }
+    emoji_table_reserve(table, total);
+  }
+  for (unsigned int i = 1; i < threads; ++i) {
+    append_chunk(table, &chunks[i]);
   }
 
-  g_strstrip(bytes);
-  cleanup(name);
-  cleanup(group);
-  cleanup(subgroup);
+  if (skipped != NULL) {
+    *skipped = (SkippedLines){0};
+    unsigned int lines_before = 0;
+    for (unsigned int i = 0; i < threads; ++i) {
+      const SkippedLines *from = &chunks[i].skipped;
+      unsigned int known = MIN(from->count, MAX_REPORTED_LINES);
+      for (unsigned int j = 0; j < known; ++j) {
+        skipped_lines_add(skipped, lines_before + from->lines[j]);
+      }
+      skipped->count += from->count - known;
+      lines_before += chunks[i].lines;
+    }
+  }
 
-  char **keywords = build_keyword_list(keywords_str, name);
+  g_free(chunks);
+  g_mapped_file_unref(file);
+  return table;
+}
 
-  Emoji *emoji = emoji_new(bytes, name, group, subgroup, keywords);
-  return emoji;
+EmojiTable *read_emojis_from_file(const char *path, SkippedLines *skipped) {
+  return read_emojis_from_file_with_threads(path, 0, skipped);
 }
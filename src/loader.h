@@ -5,9 +5,19 @@
 
 #include "emoji.h"
 
-GPtrArray *read_emojis_from_file(const char *path);
-Emoji *parse_emoji_from_line(const char *line);
+#define MAX_REPORTED_LINES 5
 
-const char *scan_until(const char until, const char *input, char **result);
+// Lines of an emoji file that could not be parsed.
+typedef struct {
+  unsigned int count;
+  // Line numbers, counting from 1, of the first MAX_REPORTED_LINES of them.
+  unsigned int lines[MAX_REPORTED_LINES];
+} SkippedLines;
+
+EmojiTable *read_emojis_from_file(const char *path, SkippedLines *skipped);
+EmojiTable *read_emojis_from_file_with_threads(const char *path,
+                                               unsigned int threads,
+                                               SkippedLines *skipped);
+gboolean parse_emoji_into_table(EmojiTable *table, const char *line);
 
 #endif // LOADER_H
@@ -0,0 +1,148 @@
+#include <glib.h>
+#include <string.h>
+
+#include "matcher.h"
+
+// Rofi tokenizes the query into one regex per word. The plugin tokenizes the
+// same query in the same way so that it can answer the query ahead of time,
+// and these helpers make sure that the tokens Rofi ends up matching with are
+// really the same before relying on those answers.
+
+/*
+ * Returns TRUE if both token lists would match exactly the same strings.
+ */
+gboolean matchers_equal(rofi_int_matcher *const *a,
+                        rofi_int_matcher *const *b) {
+  if (a == NULL || b == NULL) {
+    return a == b;
+  }
+
+  for (; *a != NULL && *b != NULL; ++a, ++b) {
+    if ((*a)->invert != (*b)->invert ||
+        g_regex_get_compile_flags((*a)->regex) !=
+            g_regex_get_compile_flags((*b)->regex) ||
+        strcmp(g_regex_get_pattern((*a)->regex),
+               g_regex_get_pattern((*b)->regex)) != 0) {
+      return FALSE;
+    }
+  }
+
+  return *a == NULL && *b == NULL;
+}
+
+/*
+ * Appends a description of the tokens to `key` that is equal for two token
+ * lists exactly when `matchers_equal` considers them equal.
+ */
+void matchers_append_key(GString *key, rofi_int_matcher *const *tokens) {
+  for (; tokens != NULL && *tokens != NULL; ++tokens) {
+    const char *pattern = g_regex_get_pattern((*tokens)->regex);
+    // Patterns are prefixed with their length, so no separator is needed.
+    g_string_append_printf(key, "%c%x:%zu:%s", (*tokens)->invert ? '-' : '+',
+                           g_regex_get_compile_flags((*tokens)->regex),
+                           strlen(pattern), pattern);
+  }
+}
+
+/*
+ * Returns the literal text the matcher searches for, or NULL if its pattern
+ * is anything more than an escaped string. This is what Rofi's default
+ * "normal" matching method produces.
+ */
+char *matcher_literal(const rofi_int_matcher *matcher) {
+  // Other flags, like G_REGEX_EXTENDED, change what a literal matches.
+  GRegexCompileFlags flags = g_regex_get_compile_flags(matcher->regex);
+  if ((flags & ~(G_REGEX_CASELESS | G_REGEX_OPTIMIZE)) != 0) {
+    return NULL;
+  }
+
+  const char *pattern = g_regex_get_pattern(matcher->regex);
+  GString *literal = g_string_sized_new(strlen(pattern));
+
+  for (const char *c = pattern; *c != '\0'; ++c) {
+    if (*c == '\\') {
+      c++;
+      // These are all the characters that `g_regex_escape_string` escapes,
+      // except for NUL.
+      if (*c == '\0' || strchr("\\|()[]{}^$*+?.", *c) == NULL) {
+        g_string_free(literal, TRUE);
+        return NULL;
+      }
+    } else if (strchr("\\|()[]{}^$*+?.", *c) != NULL) {
+      g_string_free(literal, TRUE);
+      return NULL;
+    }
+
+    g_string_append_c(literal, *c);
+  }
+
+  return g_string_free(literal, FALSE);
+}
+
+gboolean matcher_is_caseless(const rofi_int_matcher *matcher) {
+  return (g_regex_get_compile_flags(matcher->regex) & G_REGEX_CASELESS) != 0;
+}
+
+// Returns TRUE if every string matching `token` also matches `other`.
+static gboolean matcher_implies(const rofi_int_matcher *token,
+                                const rofi_int_matcher *other) {
+  if (token->invert != other->invert) {
+    return FALSE;
+  }
+
+  rofi_int_matcher *const single_token[] = {(rofi_int_matcher *)token, NULL};
+  rofi_int_matcher *const single_other[] = {(rofi_int_matcher *)other, NULL};
+  if (matchers_equal(single_token, single_other)) {
+    return TRUE;
+  }
+
+  // Only longer literals can be relied on to narrow down a match; anything
+  // that is excluded has to stay excluded in the exact same way.
+  if (token->invert) {
+    return FALSE;
+  }
+
+  // A case sensitive match also matches when ignoring case, but not the
+  // other way around.
+  if (matcher_is_caseless(token) && !matcher_is_caseless(other)) {
+    return FALSE;
+  }
+
+  char *literal = matcher_literal(token);
+  char *other_literal = matcher_literal(other);
+  gboolean implies = literal != NULL && other_literal != NULL &&
+                     strstr(literal, other_literal) != NULL;
+  g_free(literal);
+  g_free(other_literal);
+
+  return implies;
+}
+
+/*
+ * Returns TRUE if every string matching all of `tokens` is certain to match
+ * all of `previous` as well, like when a word of the query has been extended
+ * or a word has been added. The rows matching `tokens` can then be found
+ * among the rows matching `previous`.
+ */
+gboolean matchers_narrow(rofi_int_matcher *const *tokens,
+                         rofi_int_matcher *const *previous) {
+  if (previous == NULL) {
+    return TRUE;
+  }
+  if (tokens == NULL) {
+    return FALSE;
+  }
+
+  for (; *previous != NULL; ++previous) {
+    gboolean implied = FALSE;
+    for (rofi_int_matcher *const *token = tokens; *token != NULL && !implied;
+         ++token) {
+      implied = matcher_implies(*token, *previous);
+    }
+    if (!implied) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
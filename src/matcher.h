@@ -0,0 +1,17 @@
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <glib.h>
+
+// Must be included before other rofi includes.
+#include <rofi/rofi-types.h>
+
+gboolean matchers_equal(rofi_int_matcher *const *a, rofi_int_matcher *const *b);
+gboolean matchers_narrow(rofi_int_matcher *const *tokens,
+                         rofi_int_matcher *const *previous);
+void matchers_append_key(GString *key, rofi_int_matcher *const *tokens);
+
+char *matcher_literal(const rofi_int_matcher *matcher);
+gboolean matcher_is_caseless(const rofi_int_matcher *matcher);
+
+#endif // MATCHER_H
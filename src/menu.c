@@ -19,19 +19,21 @@ char *emoji_menu_get_display_value(const EmojiModePrivateData *pd,
   case EMOJI_MENU_BACK:
     return g_strdup("⬅ Back to search");
   case EMOJI_MENU_PRIMARY:
-    return format_emoji(pd->selected_emoji,
+    return format_emoji(pd->emojis, pd->selected_emoji,
                         pd->search_default_action == INSERT_EMOJI ?
                           "Copy emoji ({emoji})" : "Insert emoji ({emoji})");
   case EMOJI_MENU_SECONDARY:
-    return format_emoji(pd->selected_emoji,
+    return format_emoji(pd->emojis, pd->selected_emoji,
                         pd->search_default_action == INSERT_EMOJI ?
                           "Insert emoji ({emoji})" : "Copy emoji ({emoji})");
   case EMOJI_MENU_INSERT_NO_COPY:
-    return format_emoji(pd->selected_emoji, "Insert (without copying) emoji ({emoji})");
+    return format_emoji(pd->emojis, pd->selected_emoji,
+                        "Insert (without copying) emoji ({emoji})");
   case EMOJI_MENU_NAME:
-    return format_emoji(pd->selected_emoji, "Copy name (<tt>{name}</tt>)");
+    return format_emoji(pd->emojis, pd->selected_emoji,
+                        "Copy name (<tt>{name}</tt>)");
   case EMOJI_MENU_CODEPOINT:
-    return format_emoji(pd->selected_emoji,
+    return format_emoji(pd->emojis, pd->selected_emoji,
                         "Copy codepoint (<tt>{codepoint}</tt>)");
   default:
     return g_strdup("<invalid menu entry>");
@@ -43,7 +45,7 @@ void emoji_menu_init(EmojiModePrivateData *pd) {
     emoji_menu_destroy(pd);
   }
 
-  if (pd->selected_emoji != NULL) {
+  if (pd->selected_emoji != NO_EMOJI) {
     char **items = g_new(char *, NUM_MENU_ITEMS + 1);
     for (int i = 0; i < NUM_MENU_ITEMS; ++i) {
       items[i] = emoji_menu_get_display_value(pd, i);
@@ -66,15 +68,15 @@ unsigned int emoji_menu_get_num_entries(const EmojiModePrivateData *pd) {
 }
 
 char *emoji_menu_get_message(const EmojiModePrivateData *pd) {
-  Emoji *emoji = pd->selected_emoji;
-  if (emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     return NULL;
   }
 
-  return format_emoji(emoji, "{emoji} <span weight='bold'>{name}</span>\n"
-                             "{group} [» {subgroup}]\n"
-                             "[<span font-size='small'>Keywords: <span "
-                             "style='oblique'>{keywords}</span></span>]");
+  return format_emoji(pd->emojis, pd->selected_emoji,
+                      "{emoji} <span weight='bold'>{name}</span>\n"
+                      "{group} [» {subgroup}]\n"
+                      "[<span font-size='small'>Keywords: <span "
+                      "style='oblique'>{keywords}</span></span>]");
 }
 
 char *emoji_menu_preprocess_input(EmojiModePrivateData *pd, const char *input) {
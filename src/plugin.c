@@ -1,4 +1,5 @@
 #include <glib.h>
+#include <stdlib.h>
 
 // Must be included before other rofi includes.
 #include <rofi/mode.h>
@@ -7,12 +8,15 @@
 #include <rofi/mode-private.h>
 
 #include "actions.h"
+#include "embedded.h"
 #include "emoji.h"
 #include "formatter.h"
 #include "loader.h"
 #include "menu.h"
 #include "plugin.h"
 #include "search.h"
+#include "snapshot.h"
+#include "usage.h"
 #include "utils.h"
 
 G_MODULE_EXPORT Mode mode;
@@ -39,12 +43,92 @@ FindDataFileResult find_emoji_file(char **path) {
   }
 }
 
-static void get_emoji(EmojiModePrivateData *pd) {
+// Lists the lines of the emoji file that were left out, so that mistakes in
+// a custom emoji file do not go unnoticed.
+static char *skipped_lines_message(const char *path,
+                                   const SkippedLines *skipped) {
+  GString *lines = g_string_new("");
+  for (unsigned int i = 0; i < MIN(skipped->count, MAX_REPORTED_LINES); ++i) {
+    g_string_append_printf(lines, "%s%u", i > 0 ? ", " : "",
+                           skipped->lines[i]);
+  }
+  if (skipped->count > MAX_REPORTED_LINES) {
+    g_string_append(lines, ", …");
+  }
+
+  char *message = g_markup_printf_escaped(
+      "Skipped %u %s of <tt>%s</tt> that could not be read (%s %s)",
+      skipped->count, skipped->count == 1 ? "line" : "lines", path,
+      skipped->count == 1 ? "line" : "lines", lines->str);
+  g_string_free(lines, TRUE);
+  return message;
+}
+
+// What is needed to write a snapshot once the search is set up.
+typedef struct {
+  // NULL if the emojis were read from a snapshot, or it cannot be written.
+  char *path;
+  char *emoji_path;
+  SnapshotSource source;
+  SkippedLines skipped;
+} PendingSnapshot;
+
+// Uses the bundled emojis, which are linked into the plugin together with
+// everything that is built out of them.
+static gboolean get_embedded_emoji(EmojiModePrivateData *pd) {
+  GBytes *bytes = g_bytes_new_static(embedded_snapshot, embedded_snapshot_size);
+  Snapshot snapshot;
+  gboolean success = emoji_snapshot_map(bytes, &snapshot);
+  g_bytes_unref(bytes);
+
+  if (success) {
+    pd->emojis = snapshot.emojis;
+    pd->search_strings = snapshot.strings;
+    pd->search_index = snapshot.index;
+  }
+  return success;
+}
+
+// Reads the emoji file, or what was built out of it on an earlier launch.
+static void get_emoji(EmojiModePrivateData *pd, PendingSnapshot *pending) {
   char *path;
 
+  // The bundled emojis need no file to be read at all. Should they not be
+  // usable, like in a build for another byte order, the installed
+  // `all_emojis.txt` is read instead.
+  if (find_arg("-emoji-file") < 0 && get_embedded_emoji(pd)) {
+    return;
+  }
+
   FindDataFileResult result = find_emoji_file(&path);
   if (result == SUCCESS) {
-    pd->emojis = read_emojis_from_file(path);
+    SkippedLines *skipped = &pending->skipped;
+
+    // A snapshot from an earlier launch has everything that is needed to
+    // search. The text file is only parsed when it is missing or stale.
+    if (snapshot_source_identify(path, &pending->source)) {
+      char *snapshot_path = emoji_snapshot_path(path);
+      Snapshot snapshot;
+      if (read_emoji_snapshot(snapshot_path, path, &pending->source,
+                              &snapshot)) {
+        pd->emojis = snapshot.emojis;
+        pd->search_strings = snapshot.strings;
+        pd->search_index = snapshot.index;
+        *skipped = snapshot.skipped;
+        g_free(snapshot_path);
+      } else {
+        pending->path = snapshot_path;
+        pending->emoji_path = g_strdup(path);
+      }
+    }
+
+    if (pd->emojis == NULL) {
+      pd->emojis = read_emojis_from_file(path, skipped);
+    }
+
+    if (pd->emojis != NULL && skipped->count > 0) {
+      pd->message = skipped_lines_message(path, skipped);
+    }
   } else {
     if (result == CANNOT_DETERMINE_PATH) {
       pd->message = g_strdup(
@@ -57,6 +141,50 @@ static void get_emoji(EmojiModePrivateData *pd) {
   }
 }
 
+// Starts the clipboard adapter in the background, so that it is ready by the
+// time an emoji is selected.
+static void start_clipboard_adapter(EmojiModePrivateData *pd) {
+  char *adapter;
+  char *error = NULL;
+  if (find_clipboard_adapter(&adapter, &error)) {
+    char *log_path = clipboard_adapter_log_path();
+    pd->clipboard_adapter = clipboard_adapter_start(adapter, log_path, &error);
+    g_free(log_path);
+    g_free(adapter);
+  }
+
+  // Every action runs the adapter on its own instead, and reports the error
+  // if there still is one.
+  g_free(error);
+}
+
+// Lists the emojis that were used the most, and the most recently, first.
+static void rank_by_usage(EmojiModePrivateData *pd) {
+  char *path = usage_log_path();
+  pd->search_order = usage_log_rank(path, pd->emoji_file, pd->emojis,
+                                    g_get_real_time() / G_USEC_PER_SEC);
+  g_free(path);
+}
+
+// Writes what was built out of the emoji file to the user's cache, to save the
+// next launch from building all of it again.
+static void write_pending_snapshot(const EmojiModePrivateData *pd,
+                                   PendingSnapshot *pending) {
+  if (pending->path != NULL && pd->emojis != NULL) {
+    Snapshot snapshot = {pd->emojis, pd->search_strings, pd->search_index,
+                         pending->skipped};
+    char *error = NULL;
+    if (!write_emoji_snapshot(&snapshot, pending->emoji_path,
+                              &pending->source, pending->path, &error)) {
+      g_warning("%s", error);
+      g_free(error);
+    }
+  }
+
+  g_free(pending->path);
+  g_free(pending->emoji_path);
+}
+
 /**
  * Initialize mode
  *
@@ -69,19 +197,42 @@ static int emoji_mode_init(Mode *sw) {
     EmojiModePrivateData *pd = g_malloc0(sizeof(*pd));
 
     pd->emojis = NULL;
-    pd->selected_emoji = NULL;
+    pd->emoji_file = NULL;
+    pd->selected_emoji = NO_EMOJI;
     pd->message = NULL;
 
     // Search
     pd->search_default_action = INSERT_EMOJI;
-    pd->search_matcher_strings = NULL;
     pd->format = NULL;
-    pd->group_matchers = NULL;
-    pd->subgroup_matchers = NULL;
+    pd->search_filter = NULL;
+    pd->search_group_query = NULL;
+    pd->search_subgroup_query = NULL;
+    pd->search_format = NULL;
+    pd->display_cache = NULL;
+    pd->search_order = NULL;
+    pd->search_strings = NULL;
+    pd->search_index = NULL;
+    pd->search_tokens = NULL;
+    pd->search_matches = NULL;
+    pd->query_cache = NULL;
+    pd->search_threads = 1;
+    pd->search_pool = NULL;
 
     // Menu
     pd->menu_matcher_strings = NULL;
 
+    pd->clipboard_adapter = NULL;
+    pd->wait_for_copy = find_arg("-emoji-wait-for-copy") >= 0;
+
+    char *emoji_file;
+    if (find_arg_str("-emoji-file", &emoji_file)) {
+      // Usage is recorded per emoji file, so it must be named the same way
+      // whatever directory Rofi is started from or link it is reached by.
+      char *resolved = realpath(emoji_file, NULL);
+      pd->emoji_file = g_strdup(resolved != NULL ? resolved : emoji_file);
+      free(resolved);
+    }
+
     if (find_arg("-emoji-format")) {
       char *format;
       if (find_arg_str("-emoji-format", &format)) {
@@ -91,6 +242,12 @@ static int emoji_mode_init(Mode *sw) {
       }
     }
 
+    unsigned int threads;
+    if (find_arg_uint("-emoji-threads", &threads)) {
+      // 0 means one thread per processor.
+      pd->search_threads = threads > 0 ? threads : g_get_num_processors();
+    }
+
     if (find_arg("-emoji-mode")) {
       char *format;
       if (find_arg_str("-emoji-mode", &format)) {
@@ -111,13 +268,20 @@ static int emoji_mode_init(Mode *sw) {
       }
     }
 
-    get_emoji(pd);
+    PendingSnapshot pending = {0};
+    get_emoji(pd, &pending);
     if (pd->emojis == NULL) {
+      write_pending_snapshot(pd, &pending);
       return FALSE;
     }
 
     emoji_search_init(pd);
+    write_pending_snapshot(pd, &pending);
+    rank_by_usage(pd);
     emoji_menu_init(pd);
+    if (find_arg("-emoji-persistent-adapter") >= 0) {
+      start_clipboard_adapter(pd);
+    }
     mode_set_private_data(sw, (void *)pd);
   }
   return TRUE;
@@ -133,7 +297,7 @@ static int emoji_mode_init(Mode *sw) {
 static unsigned int emoji_mode_get_num_entries(const Mode *sw) {
   const EmojiModePrivateData *pd =
       (const EmojiModePrivateData *)mode_get_private_data(sw);
-  if (pd->selected_emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     return emoji_search_get_num_entries(pd);
   } else {
     return emoji_menu_get_num_entries(pd);
@@ -180,7 +344,7 @@ static ModeMode emoji_mode_result(Mode *sw, int mretv, char **input,
   }
 
   Action action = EXIT_SEARCH;
-  if (pd->selected_emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     action = emoji_search_on_event(pd, event, selected_line);
   } else {
     action = emoji_menu_on_event(pd, event, selected_line);
@@ -200,11 +364,13 @@ static void emoji_mode_destroy(Mode *sw) {
   if (pd != NULL) {
     emoji_search_destroy(pd);
     emoji_menu_destroy(pd);
+    clipboard_adapter_stop(pd->clipboard_adapter);
 
-    pd->selected_emoji = NULL; // Freed via the emojis list
-    g_ptr_array_free(pd->emojis, TRUE);
+    pd->selected_emoji = NO_EMOJI;
+    emoji_table_free(pd->emojis);
 
     g_free(pd->message);
+    g_free(pd->emoji_file);
     g_free(pd->format);
     g_free(pd);
     mode_set_private_data(sw, NULL);
@@ -226,7 +392,7 @@ static char *emoji_get_message(const Mode *sw) {
     return g_strdup(pd->message);
   }
 
-  if (pd->selected_emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     return emoji_search_get_message(pd);
   } else {
     return emoji_menu_get_message(pd);
@@ -259,7 +425,7 @@ static char *emoji_get_display_value(const Mode *sw, unsigned int selected_line,
     return NULL;
   }
 
-  if (pd->selected_emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     return emoji_search_get_display_value(pd, selected_line);
   } else {
     return emoji_menu_get_display_value(pd, selected_line);
@@ -279,7 +445,7 @@ static int emoji_token_match(const Mode *sw, rofi_int_matcher **tokens,
                              unsigned int index) {
   EmojiModePrivateData *pd = (EmojiModePrivateData *)mode_get_private_data(sw);
 
-  if (pd->selected_emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     return emoji_search_token_match(pd, tokens, index);
   } else {
     return emoji_menu_token_match(pd, tokens, index);
@@ -288,7 +454,7 @@ static int emoji_token_match(const Mode *sw, rofi_int_matcher **tokens,
 
 static char *emoji_preprocess_input(Mode *sw, const char *input) {
   EmojiModePrivateData *pd = (EmojiModePrivateData *)mode_get_private_data(sw);
-  if (pd->selected_emoji == NULL) {
+  if (pd->selected_emoji == NO_EMOJI) {
     return emoji_search_preprocess_input(pd, input);
   } else {
     return emoji_menu_preprocess_input(pd, input);
@@ -7,7 +7,13 @@
 #include <rofi/mode.h>
 
 #include "actions.h"
+#include "adapter.h"
+#include "bitset.h"
+#include "cache.h"
 #include "emoji.h"
+#include "formatter.h"
+#include "literal.h"
+#include "trigram.h"
 
 typedef enum {
   SELECT_DEFAULT,
@@ -16,20 +22,55 @@ typedef enum {
   EXIT,
 } Event;
 
+// No emoji is selected, and the search is shown instead of the menu.
+#define NO_EMOJI G_MAXUINT
+
 typedef struct {
-  GPtrArray *emojis;
-  Emoji *selected_emoji;
+  EmojiTable *emojis;
+  // The path given with -emoji-file, or NULL for the bundled emojis.
+  char *emoji_file;
+  // Row of the emoji the menu is open for.
+  unsigned int selected_emoji;
   char *message;
 
   // For search
   Action search_default_action;
-  char **search_matcher_strings;
   char *format;
-  rofi_int_matcher **group_matchers;
-  rofi_int_matcher **subgroup_matchers;
+  // `format` (or the default format) compiled once at startup.
+  EmojiFormat *search_format;
+  // Rendered display values by row.
+  Cache *display_cache;
+  // The row listed on every line, with the emojis used the most and the most
+  // recently first. NULL to list the rows in the order of the table.
+  unsigned int *search_order;
+  // Rows allowed by the current `@group` and `#subgroup` filters. NULL when
+  // there are no filters.
+  Bitset *search_filter;
+  char *search_group_query;
+  char *search_subgroup_query;
+  // The "{emoji} {name} {keywords}" string of every row, which is what
+  // queries are matched against.
+  LiteralMatcher *search_strings;
+  TrigramIndex *search_index;
+  // The current query as tokenized by the plugin, and the rows matching it and
+  // the filters. NULL until the first query.
+  rofi_int_matcher **search_tokens;
+  Bitset *search_matches;
+  // Rows matching recent searches.
+  Cache *query_cache;
+  // Number of threads to match large tables with, and the pool of them.
+  unsigned int search_threads;
+  GThreadPool *search_pool;
 
   // For menu
   char **menu_matcher_strings;
+
+  // The clipboard adapter kept running with `-emoji-persistent-adapter`, or
+  // NULL to run it for every action.
+  ClipboardAdapter *clipboard_adapter;
+  // Wait for copying to finish with `-emoji-wait-for-copy`, to show errors
+  // in rofi. Inserting never waits, since rofi is already hidden by then.
+  gboolean wait_for_copy;
 } EmojiModePrivateData;
 
 #endif // PLUGIN_H
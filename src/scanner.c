@@ -0,0 +1,73 @@
+#include <glib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "scanner.h"
+
+// Lines are split by looking at 16 bytes at a time and noting every delimiter
+// in them in a bit mask. Fields are then found by walking the set bits, so
+// every byte of a line is only looked at once no matter how many fields and
+// keywords it has.
+
+#define BLOCK_SIZE 16
+
+static gboolean is_delimiter(char c) {
+  return c == '\t' || c == '|' || c == '\n' || c == '\0';
+}
+
+// Returns a mask of the delimiters in the `length` (at most BLOCK_SIZE) bytes
+// at `block`.
+static guint32 scan_block(const char *block, gsize length) {
+#ifdef __SSE2__
+  if (length == BLOCK_SIZE) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)block);
+    __m128i tabs = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'));
+    __m128i pipes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('|'));
+    __m128i newlines = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'));
+    __m128i nuls = _mm_cmpeq_epi8(bytes, _mm_setzero_si128());
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(tabs, pipes),
+                                          _mm_or_si128(newlines, nuls)));
+  }
+#endif
+
+  // Without SSE2, and for the last bytes of the text, which must not be read
+  // past.
+  guint32 mask = 0;
+  for (gsize i = 0; i < length; ++i) {
+    if (is_delimiter(block[i])) {
+      mask |= 1u << i;
+    }
+  }
+  return mask;
+}
+
+void field_scanner_init(FieldScanner *scanner, const char *text,
+                        gsize length) {
+  scanner->text = text;
+  scanner->length = length;
+  scanner->block = 0;
+  scanner->mask = scan_block(text, MIN(length, BLOCK_SIZE));
+}
+
+/*
+ * Returns the next tab, pipe, newline or NUL byte in the text, or NULL if
+ * there are none left.
+ */
+const char *field_scanner_next(FieldScanner *scanner) {
+  while (scanner->mask == 0) {
+    scanner->block += BLOCK_SIZE;
+    if (scanner->block >= scanner->length) {
+      return NULL;
+    }
+    scanner->mask =
+        scan_block(scanner->text + scanner->block,
+                   MIN(scanner->length - scanner->block, BLOCK_SIZE));
+  }
+
+  const char *delimiter =
+      scanner->text + scanner->block + __builtin_ctz(scanner->mask);
+  scanner->mask &= scanner->mask - 1;
+  return delimiter;
+}
@@ -0,0 +1,21 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <glib.h>
+
+// Finds the characters that delimit fields in emoji files: tabs, pipes,
+// newlines and NUL bytes.
+typedef struct {
+  const char *text;
+  gsize length;
+  // Offset of the block of text that `mask` describes.
+  gsize block;
+  // One bit for every delimiter in the block that has not been returned yet.
+  guint32 mask;
+} FieldScanner;
+
+void field_scanner_init(FieldScanner *scanner, const char *text,
+                        gsize length);
+const char *field_scanner_next(FieldScanner *scanner);
+
+#endif // SCANNER_H
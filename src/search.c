@@ -1,29 +1,99 @@
 #include <rofi/helper.h>
+#include <string.h>
 
 #include "actions.h"
+#include "cache.h"
 #include "formatter.h"
+#include "literal.h"
+#include "matcher.h"
 #include "search.h"
+#include "trigram.h"
 #include "utils.h"
 
+// Number of rendered display values to keep around. Rofi asks for the same
+// visible lines again on every redraw.
+#define DISPLAY_CACHE_SIZE 1024
+
+// Memory to spend on remembering the rows matching recent queries, so that
+// going back to a previous query while typing skips matching entirely.
+#define QUERY_CACHE_BUDGET (1024 * 1024)
+
+// Smaller tables are matched faster than the threads can be woken up.
+#define PARALLEL_MIN_ROWS 16384
+
 const char *DEFAULT_FORMAT = "{emoji} <span weight='bold'>{name}</span>"
                              "[ <span size='small'>({keywords})</span>]";
 
-char **generate_matcher_strings(GPtrArray *list);
+static void match_chunk(gpointer data, gpointer user_data);
 
 void emoji_search_init(EmojiModePrivateData *pd) {
-  pd->search_matcher_strings = generate_matcher_strings(pd->emojis);
+  const char *format = pd->format;
+  if (format == NULL || format[0] == '\0') {
+    format = DEFAULT_FORMAT;
+  }
+
+  pd->search_format = emoji_format_new(format);
+  // Both the format and the table are fixed from here on, so cached display
+  // values never have to be invalidated until the mode is destroyed.
+  pd->display_cache = cache_new(DISPLAY_CACHE_SIZE, g_direct_hash,
+                                g_direct_equal, NULL, g_free);
+  pd->query_cache = cache_new(QUERY_CACHE_BUDGET, g_str_hash, g_str_equal,
+                              g_free, (GDestroyNotify)bitset_free);
+
+  // Both are already there when they were read from a snapshot.
+  if (pd->search_strings == NULL || pd->search_index == NULL) {
+    char **matcher_strings = generate_matcher_strings(pd->emojis);
+    pd->search_index = trigram_index_new(matcher_strings, pd->emojis->len);
+    pd->search_strings = literal_matcher_new(matcher_strings, pd->emojis->len);
+    g_strfreev(matcher_strings);
+  }
+
+  if (pd->search_threads > 1 && pd->emojis->len >= PARALLEL_MIN_ROWS) {
+    pd->search_pool =
+        g_thread_pool_new(match_chunk, NULL, pd->search_threads, FALSE, NULL);
+  }
 }
 
 void emoji_search_destroy(EmojiModePrivateData *pd) {
-  g_strfreev(pd->search_matcher_strings);
-  helper_tokenize_free(pd->group_matchers);
-  helper_tokenize_free(pd->subgroup_matchers);
+  if (pd->search_pool != NULL) {
+    g_thread_pool_free(pd->search_pool, TRUE, TRUE);
+  }
+  if (pd->display_cache != NULL) {
+    g_debug("Display cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT
+            " misses",
+            pd->display_cache->hits, pd->display_cache->misses);
+  }
+  cache_free(pd->display_cache);
+  if (pd->query_cache != NULL) {
+    g_debug("Query cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT
+            " misses",
+            pd->query_cache->hits, pd->query_cache->misses);
+  }
+  cache_free(pd->query_cache);
+  emoji_format_free(pd->search_format);
+  literal_matcher_free(pd->search_strings);
+  bitset_free(pd->search_filter);
+  trigram_index_free(pd->search_index);
+  helper_tokenize_free(pd->search_tokens);
+  bitset_free(pd->search_matches);
+  g_free(pd->search_order);
+  g_free(pd->search_group_query);
+  g_free(pd->search_subgroup_query);
 }
 
 unsigned int emoji_search_get_num_entries(const EmojiModePrivateData *pd) {
   return pd->emojis->len;
 }
 
+/*
+ * Returns the row of the emoji listed on `line` of the search, which must be
+ * in range.
+ */
+unsigned int emoji_search_row(const EmojiModePrivateData *pd,
+                              unsigned int line) {
+  return pd->search_order != NULL ? pd->search_order[line] : line;
+}
+
 char *emoji_search_get_message(const EmojiModePrivateData *pd) { return NULL; }
 
 char *emoji_search_get_display_value(const EmojiModePrivateData *pd,
@@ -32,18 +102,274 @@ char *emoji_search_get_display_value(const EmojiModePrivateData *pd,
     return g_strdup("");
   }
 
-  Emoji *emoji = g_ptr_array_index(pd->emojis, line);
-  const char *format = pd->format;
-  if (format == NULL || format[0] == '\0') {
-    format = DEFAULT_FORMAT;
+  unsigned int row = emoji_search_row(pd, line);
+  char *cached = cache_lookup(pd->display_cache, GUINT_TO_POINTER(row));
+  if (cached != NULL) {
+    return g_strdup(cached);
+  }
+
+  char *display = emoji_format_render(pd->search_format, pd->emojis, row);
+  cache_insert(pd->display_cache, GUINT_TO_POINTER(row), g_strdup(display), 1);
+  return display;
+}
+
+// Matches a filter query against each distinct group (or subgroup) once,
+// instead of against every emoji. Returns NULL if there is no query.
+static gboolean *match_groups(const char *query, const GPtrArray *groups) {
+  if (query == NULL) {
+    return NULL;
+  }
+
+  rofi_int_matcher **matchers = helper_tokenize(query, FALSE);
+  gboolean *matches = g_new(gboolean, MAX(groups->len, 1));
+  for (guint i = 0; i < groups->len; ++i) {
+    matches[i] = helper_token_match(matchers, g_ptr_array_index(groups, i));
+  }
+  helper_tokenize_free(matchers);
+
+  return matches;
+}
+
+// Resolves the `@group` and `#subgroup` filters into the set of rows they
+// allow. Returns NULL if there are no filters.
+static Bitset *build_search_filter(const EmojiTable *table,
+                                   const char *group_query,
+                                   const char *subgroup_query) {
+  if (group_query == NULL && subgroup_query == NULL) {
+    return NULL;
+  }
+
+  gboolean *groups = match_groups(group_query, table->groups);
+  gboolean *subgroups = match_groups(subgroup_query, table->subgroups);
+
+  Bitset *filter = bitset_new(table->len);
+  for (unsigned int i = 0; i < table->len; ++i) {
+    if ((groups == NULL || groups[table->group_ids[i]]) &&
+        (subgroups == NULL || subgroups[table->subgroup_ids[i]])) {
+      bitset_set(filter, i);
+    }
   }
 
-  if (emoji == NULL) {
-    return g_strdup("n/a");
+  g_free(groups);
+  g_free(subgroups);
+
+  return filter;
+}
+
+// Decides on case sensitivity the same way Rofi does, as far as the command
+// line tells. With -case-smart, Rofi looks at the input as it was typed, so
+// that is what has to be passed here, group and subgroup filters included.
+// Should Rofi still decide differently, its tokens will not match the plugin's
+// and every row is matched by Rofi instead.
+static int is_case_sensitive(const char *input) {
+  if (find_arg("-case-smart") >= 0) {
+    if (!g_utf8_validate(input, -1, NULL)) {
+      for (const char *c = input; *c != '\0'; ++c) {
+        if (g_ascii_isupper(*c)) {
+          return TRUE;
+        }
+      }
+      return FALSE;
+    }
+
+    for (const char *c = input; *c != '\0'; c = g_utf8_next_char(c)) {
+      if (g_unichar_isupper(g_utf8_get_char(c))) {
+        return TRUE;
+      }
+    }
+    return FALSE;
+  }
+
+  return find_arg("-case-sensitive") >= 0;
+}
+
+typedef struct {
+  char *literal;
+  gboolean caseless;
+  gboolean invert;
+} LiteralToken;
+
+// Matching the tokens of a query against a set of rows.
+typedef struct {
+  const EmojiModePrivateData *pd;
+  GArray *literals;
+  // NULL-terminated tokens to match with Rofi's matcher.
+  GPtrArray *regex_tokens;
+  // Candidate rows, which are cleared when they do not match.
+  Bitset *rows;
+
+  // For parallel matching.
+  GMutex lock;
+  GCond done;
+  unsigned int pending;
+} MatchJob;
+
+typedef struct {
+  MatchJob *job;
+  unsigned int first;
+  unsigned int last;
+} MatchChunk;
+
+// Matches the rows from `first` up to `last`.
+static void match_range(MatchJob *job, unsigned int first, unsigned int last) {
+  for (guint i = 0; i < job->literals->len; ++i) {
+    const LiteralToken *token = &g_array_index(job->literals, LiteralToken, i);
+    literal_matcher_filter(job->pd->search_strings, token->literal,
+                           token->caseless, token->invert, job->rows, first,
+                           last);
+  }
+
+  rofi_int_matcher **tokens = (rofi_int_matcher **)job->regex_tokens->pdata;
+  if (tokens[0] == NULL) {
+    return;
+  }
+
+  for (unsigned int i = bitset_next_before(job->rows, first, last); i < last;
+       i = bitset_next_before(job->rows, i + 1, last)) {
+    const char *str = literal_matcher_string(job->pd->search_strings, i);
+    if (!helper_token_match(tokens, str)) {
+      bitset_clear(job->rows, i);
+    }
+  }
+}
+
+static void match_chunk(gpointer data, gpointer user_data) {
+  MatchChunk *chunk = data;
+  MatchJob *job = chunk->job;
+
+  match_range(job, chunk->first, chunk->last);
+
+  g_mutex_lock(&job->lock);
+  if (--job->pending == 0) {
+    g_cond_signal(&job->done);
+  }
+  g_mutex_unlock(&job->lock);
+}
+
+// Splits the rows into one chunk per thread and waits for all of them to be
+// matched. Chunks cover whole words of the bitset, so no two threads ever
+// write to the same word.
+static void match_parallel(GThreadPool *pool, unsigned int threads,
+                           MatchJob *job) {
+  unsigned int words = BITSET_WORDS(job->rows->size);
+  unsigned int chunk_size = (words + threads - 1) / threads * BITSET_WORD_BITS;
+
+  unsigned int count = (job->rows->size + chunk_size - 1) / chunk_size;
+  MatchChunk *chunks = g_new(MatchChunk, count);
+
+  g_mutex_init(&job->lock);
+  g_cond_init(&job->done);
+  job->pending = count;
+
+  for (unsigned int i = 0; i < count; ++i) {
+    chunks[i].job = job;
+    chunks[i].first = i * chunk_size;
+    chunks[i].last = MIN((i + 1) * chunk_size, job->rows->size);
+    g_thread_pool_push(pool, &chunks[i], NULL);
+  }
+
+  g_mutex_lock(&job->lock);
+  while (job->pending > 0) {
+    g_cond_wait(&job->done, &job->lock);
+  }
+  g_mutex_unlock(&job->lock);
+
+  g_mutex_clear(&job->lock);
+  g_cond_clear(&job->done);
+  g_free(chunks);
+}
+
+// Finds the rows matching every token, using the trigram index to skip rows
+// that cannot contain the literal tokens. If `within` is set, only those rows
+// are considered.
+static Bitset *find_matches(const EmojiModePrivateData *pd,
+                            rofi_int_matcher **tokens, const Bitset *within) {
+  Bitset *candidates;
+  if (within != NULL) {
+    candidates = bitset_copy(within);
+  } else if (pd->search_filter != NULL) {
+    candidates = bitset_copy(pd->search_filter);
   } else {
+    candidates = bitset_new(pd->emojis->len);
+    bitset_fill(candidates);
+  }
+
+  if (tokens == NULL) {
+    return candidates;
+  }
+
+  for (int i = 0; tokens[i] != NULL; ++i) {
+    char *literal = tokens[i]->invert ? NULL : matcher_literal(tokens[i]);
+    if (literal == NULL) {
+      continue;
+    }
+
+    Bitset *rows = trigram_index_lookup(pd->search_index, literal,
+                                        matcher_is_caseless(tokens[i]));
+    if (rows != NULL) {
+      bitset_and(candidates, rows);
+      bitset_free(rows);
+    }
+    g_free(literal);
+  }
+
+  // Plain literals are matched directly against the strings, which is much
+  // cheaper than running a regex for every row. Only the remaining tokens
+  // are left to Rofi's matcher.
+  MatchJob job = {
+      .pd = pd,
+      .literals = g_array_new(FALSE, FALSE, sizeof(LiteralToken)),
+      .regex_tokens = g_ptr_array_new(),
+      .rows = candidates,
+  };
+  for (int i = 0; tokens[i] != NULL; ++i) {
+    LiteralToken token = {
+        .literal = matcher_literal(tokens[i]),
+        .caseless = matcher_is_caseless(tokens[i]),
+        .invert = tokens[i]->invert,
+    };
 
-    return format_emoji(emoji, format);
+    if (token.literal != NULL &&
+        literal_matcher_supports(pd->search_strings, token.literal,
+                                 token.caseless)) {
+      g_array_append_val(job.literals, token);
+    } else {
+      g_free(token.literal);
+      g_ptr_array_add(job.regex_tokens, tokens[i]);
+    }
   }
+  g_ptr_array_add(job.regex_tokens, NULL);
+
+  if (pd->search_pool != NULL && candidates->size >= PARALLEL_MIN_ROWS) {
+    match_parallel(pd->search_pool, pd->search_threads, &job);
+  } else {
+    match_range(&job, 0, candidates->size);
+  }
+
+  for (guint i = 0; i < job.literals->len; ++i) {
+    g_free(g_array_index(job.literals, LiteralToken, i).literal);
+  }
+  g_array_free(job.literals, TRUE);
+  g_ptr_array_free(job.regex_tokens, TRUE);
+
+  return candidates;
+}
+
+static void append_filter_key(GString *key, char prefix, const char *query) {
+  if (query != NULL) {
+    g_string_append_printf(key, "%c%zu:%s", prefix, strlen(query), query);
+  }
+}
+
+// Returns a key that is equal for two searches exactly when they match the
+// same rows.
+static char *query_key(const EmojiModePrivateData *pd,
+                       rofi_int_matcher **tokens) {
+  GString *key = g_string_new("");
+  append_filter_key(key, '@', pd->search_group_query);
+  append_filter_key(key, '#', pd->search_subgroup_query);
+  matchers_append_key(key, tokens);
+  return g_string_free(key, FALSE);
 }
 
 char *emoji_search_preprocess_input(EmojiModePrivateData *pd,
@@ -52,25 +378,54 @@ char *emoji_search_preprocess_input(EmojiModePrivateData *pd,
   char *group_query;
   char *subgroup_query;
 
-  if (pd->group_matchers != NULL) {
-    helper_tokenize_free(pd->group_matchers);
-    pd->group_matchers = NULL;
-  }
-  if (pd->subgroup_matchers != NULL) {
-    helper_tokenize_free(pd->subgroup_matchers);
-    pd->subgroup_matchers = NULL;
-  }
-
   tokenize_search(input, &query, &group_query, &subgroup_query);
 
-  if (group_query != NULL) {
-    pd->group_matchers = helper_tokenize(group_query, FALSE);
+  gboolean same_filters =
+      g_strcmp0(group_query, pd->search_group_query) == 0 &&
+      g_strcmp0(subgroup_query, pd->search_subgroup_query) == 0;
+  if (same_filters) {
+    g_free(group_query);
+    g_free(subgroup_query);
+  } else {
+    bitset_free(pd->search_filter);
+    pd->search_filter =
+        build_search_filter(pd->emojis, group_query, subgroup_query);
+
+    g_free(pd->search_group_query);
+    g_free(pd->search_subgroup_query);
+    pd->search_group_query = group_query;
+    pd->search_subgroup_query = subgroup_query;
   }
 
-  if (subgroup_query != NULL) {
-    pd->subgroup_matchers = helper_tokenize(subgroup_query, FALSE);
+  // Rofi will tokenize the returned query and ask about every row. Tokenizing
+  // it here as well allows answering the whole query at once.
+  rofi_int_matcher **tokens = helper_tokenize(query, is_case_sensitive(input));
+
+  char *key = query_key(pd, tokens);
+  Bitset *matches = cache_lookup(pd->query_cache, key);
+  if (matches != NULL) {
+    matches = bitset_copy(matches);
+    g_free(key);
+  } else {
+    // While typing, the new query usually narrows down the previous one. Only
+    // the rows that matched before can match then.
+    const Bitset *previous_matches = NULL;
+    if (same_filters && pd->search_matches != NULL &&
+        matchers_narrow(tokens, pd->search_tokens)) {
+      previous_matches = pd->search_matches;
+    }
+
+    matches = find_matches(pd, tokens, previous_matches);
+    cache_insert(pd->query_cache, key, bitset_copy(matches),
+                 strlen(key) + sizeof(Bitset) +
+                     BITSET_WORDS(matches->size) * sizeof(guint64));
   }
 
+  helper_tokenize_free(pd->search_tokens);
+  bitset_free(pd->search_matches);
+  pd->search_tokens = tokens;
+  pd->search_matches = matches;
+
   return query;
 }
 
@@ -80,23 +435,18 @@ int emoji_search_token_match(const EmojiModePrivateData *pd,
     return FALSE;
   }
 
-  if (pd->group_matchers != NULL || pd->subgroup_matchers != NULL) {
-    Emoji *emoji = g_ptr_array_index(pd->emojis, line);
-
-    if (pd->group_matchers != NULL) {
-      if (!helper_token_match(pd->group_matchers, emoji->group)) {
-        return FALSE;
-      }
-    }
+  unsigned int row = emoji_search_row(pd, line);
+  if (pd->search_matches != NULL &&
+      matchers_equal(tokens, pd->search_tokens)) {
+    return bitset_get(pd->search_matches, row);
+  }
 
-    if (pd->subgroup_matchers != NULL) {
-      if (!helper_token_match(pd->subgroup_matchers, emoji->subgroup)) {
-        return FALSE;
-      }
-    }
+  if (pd->search_filter != NULL && !bitset_get(pd->search_filter, row)) {
+    return FALSE;
   }
 
-  return helper_token_match(tokens, pd->search_matcher_strings[line]);
+  return helper_token_match(tokens,
+                            literal_matcher_string(pd->search_strings, row));
 }
 
 Action emoji_search_on_event(EmojiModePrivateData *pd, const Event event,
@@ -120,14 +470,3 @@ Action emoji_search_on_event(EmojiModePrivateData *pd, const Event event,
     return NOOP;
   }
 }
-
-char **generate_matcher_strings(GPtrArray *list) {
-  char **strings = g_new(char *, list->len + 1);
-  for (int i = 0; i < list->len; ++i) {
-    Emoji *emoji = g_ptr_array_index(list, i);
-
-    strings[i] = format_emoji(emoji, "{emoji} {name} {keywords}");
-  }
-  strings[list->len] = NULL;
-  return strings;
-}
@@ -4,10 +4,14 @@
 #include "actions.h"
 #include "plugin.h"
 
+extern const char *DEFAULT_FORMAT;
+
 void emoji_search_init(EmojiModePrivateData *pd);
 void emoji_search_destroy(EmojiModePrivateData *pd);
 
 unsigned int emoji_search_get_num_entries(const EmojiModePrivateData *pd);
+unsigned int emoji_search_row(const EmojiModePrivateData *pd,
+                              unsigned int line);
 char *emoji_search_get_message(const EmojiModePrivateData *pd);
 char *emoji_search_get_display_value(const EmojiModePrivateData *pd,
                                      unsigned int line);
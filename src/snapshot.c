@@ -0,0 +1,277 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "database.h"
+#include "snapshot.h"
+#include "utils.h"
+
+// A snapshot is everything the plugin builds out of an emoji file at startup,
+// written to the user's cache directory so that later launches can map it
+// instead of building it again:
+//
+//   [header][path][emoji table][matcher strings][trigram index]
+//
+// The emoji table is stored in the database format, and the matcher strings
+// and index in the formats of `literal.c` and `trigram.c`. Each of them
+// starts at a multiple of 8 bytes, and checks its own data when it is mapped.
+//
+// A snapshot is keyed by the path of the emoji file, and only used if the
+// size, modification time and a hash of the contents of the file are still
+// the same as when it was written. Anything else is rebuilt from the file.
+
+#define SNAPSHOT_MAGIC "RFEMOSN"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_ALIGNMENT 8
+
+typedef struct {
+  char magic[8];
+  guint32 version;
+  guint32 byte_order;
+  guint64 source_size;
+  gint64 source_mtime;
+  guint64 source_hash;
+  guint32 path_offset;
+  guint32 path_length;
+  guint32 table_offset;
+  guint32 table_length;
+  guint32 strings_offset;
+  guint32 strings_length;
+  guint32 index_offset;
+  guint32 index_length;
+  guint32 skipped_count;
+  guint32 skipped_lines[MAX_REPORTED_LINES];
+} SnapshotHeader;
+
+/*
+ * Returns the path of the snapshot of the given emoji file in
+ * `$XDG_CACHE_HOME/rofi-emoji/`, named after a hash of the file's path.
+ */
+char *emoji_snapshot_path(const char *source_path) {
+  char *current_dir = g_get_current_dir();
+  char *absolute = g_path_is_absolute(source_path)
+                       ? g_strdup(source_path)
+                       : g_build_filename(current_dir, source_path, NULL);
+  char *hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, absolute, -1);
+  char *name = g_strconcat(hash, ".snapshot", NULL);
+  char *path =
+      g_build_filename(g_get_user_cache_dir(), "rofi-emoji", name, NULL);
+
+  g_free(name);
+  g_free(hash);
+  g_free(absolute);
+  g_free(current_dir);
+  return path;
+}
+
+/*
+ * Fills in what identifies the current contents of the emoji file. Call it
+ * before reading the file, so that a snapshot written afterwards is never
+ * keyed by newer contents than it was built from.
+ *
+ * Returns FALSE if the file cannot be read.
+ */
+int snapshot_source_identify(const char *source_path, SnapshotSource *source) {
+  struct stat info;
+  if (stat(source_path, &info) != 0) {
+    return FALSE;
+  }
+
+  GMappedFile *file = g_mapped_file_new(source_path, FALSE, NULL);
+  if (file == NULL) {
+    return FALSE;
+  }
+
+  source->size = info.st_size;
+  source->mtime = info.st_mtime;
+  source->hash = hash_data(g_mapped_file_get_contents(file),
+                           g_mapped_file_get_length(file));
+  g_mapped_file_unref(file);
+  return TRUE;
+}
+
+// Pads `out` with zeros to the start of the next section of the snapshot
+// starting at `start`, and returns the offset of the section in the snapshot.
+static guint32 start_section(GString *out, gsize start) {
+  while ((out->len - start) % SNAPSHOT_ALIGNMENT != 0) {
+    g_string_append_c(out, '\0');
+  }
+  return out->len - start;
+}
+
+/*
+ * Appends `snapshot`, built out of the emoji file at `source_path` as
+ * identified by `source`, to `out`. The snapshot must start at a multiple of
+ * 8 bytes in memory to be mapped.
+ */
+void emoji_snapshot_append(const Snapshot *snapshot, const char *source_path,
+                           const SnapshotSource *source, GString *out) {
+  SnapshotHeader header = {
+      .magic = SNAPSHOT_MAGIC,
+      .version = SNAPSHOT_VERSION,
+      .byte_order = SNAPSHOT_BYTE_ORDER,
+      .source_size = source->size,
+      .source_mtime = source->mtime,
+      .source_hash = source->hash,
+      .skipped_count = snapshot->skipped.count,
+  };
+  memcpy(header.skipped_lines, snapshot->skipped.lines,
+         sizeof(header.skipped_lines));
+
+  gsize start = out->len;
+  g_string_append_len(out, (const char *)&header, sizeof(header));
+
+  header.path_offset = start_section(out, start);
+  header.path_length = strlen(source_path);
+  g_string_append_len(out, source_path, header.path_length + 1);
+
+  header.table_offset = start_section(out, start);
+  emoji_database_append(snapshot->emojis, source->size, out);
+  header.table_length = out->len - start - header.table_offset;
+
+  header.strings_offset = start_section(out, start);
+  literal_matcher_write(snapshot->strings, out);
+  header.strings_length = out->len - start - header.strings_offset;
+
+  header.index_offset = start_section(out, start);
+  trigram_index_write(snapshot->index, out);
+  header.index_length = out->len - start - header.index_offset;
+
+  memcpy(out->str + start, &header, sizeof(header));
+}
+
+int write_emoji_snapshot(const Snapshot *snapshot, const char *source_path,
+                         const SnapshotSource *source, const char *path,
+                         char **error) {
+  GString *out = g_string_sized_new(1024 * 1024);
+  emoji_snapshot_append(snapshot, source_path, source, out);
+
+  char *directory = g_path_get_dirname(path);
+  GError *write_error = NULL;
+  int success = FALSE;
+  if (g_mkdir_with_parents(directory, 0700) != 0) {
+    *error = g_strdup_printf("Cannot create %s", directory);
+  } else if (!g_file_set_contents(path, out->str, out->len, &write_error)) {
+    *error = g_strdup_printf("Cannot write %s: %s", path, write_error->message);
+    g_error_free(write_error);
+  } else {
+    success = TRUE;
+  }
+
+  g_free(directory);
+  g_string_free(out, TRUE);
+  return success;
+}
+
+static int section_fits(guint64 offset, guint64 length, guint64 size) {
+  return offset % SNAPSHOT_ALIGNMENT == 0 && offset + length <= size;
+}
+
+/*
+ * Uses the snapshot in `bytes`, written by `emoji_snapshot_append()`, and
+ * fills in `snapshot` with what it holds. Nothing is copied; everything points
+ * into `bytes`, which is released once all of it is freed.
+ *
+ * Returns FALSE if the snapshot is invalid. Unlike `read_emoji_snapshot()`,
+ * this does not check which emoji file the snapshot was built out of.
+ */
+int emoji_snapshot_map(GBytes *bytes, Snapshot *snapshot) {
+  gsize size;
+  const char *data = g_bytes_get_data(bytes, &size);
+  if (data == NULL || size < sizeof(SnapshotHeader)) {
+    return FALSE;
+  }
+
+  const SnapshotHeader *header = (const SnapshotHeader *)data;
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SNAPSHOT_VERSION ||
+      header->byte_order != SNAPSHOT_BYTE_ORDER ||
+      !section_fits(header->path_offset, (guint64)header->path_length + 1,
+                    size) ||
+      !section_fits(header->table_offset, header->table_length, size) ||
+      !section_fits(header->strings_offset, header->strings_length, size) ||
+      !section_fits(header->index_offset, header->index_length, size)) {
+    return FALSE;
+  }
+
+  EmojiTable *emojis = emoji_database_map(
+      bytes, header->table_offset, header->table_length, header->source_size);
+  LiteralMatcher *strings = NULL;
+  TrigramIndex *index = NULL;
+  if (emojis != NULL) {
+    strings = literal_matcher_map(bytes, header->strings_offset,
+                                  header->strings_length, emojis->len);
+    index = trigram_index_map(bytes, header->index_offset, header->index_length,
+                              emojis->len);
+  }
+
+  if (strings == NULL || index == NULL) {
+    emoji_table_free(emojis);
+    literal_matcher_free(strings);
+    trigram_index_free(index);
+    return FALSE;
+  }
+
+  snapshot->emojis = emojis;
+  snapshot->strings = strings;
+  snapshot->index = index;
+  snapshot->skipped.count = header->skipped_count;
+  memcpy(snapshot->skipped.lines, header->skipped_lines,
+         sizeof(snapshot->skipped.lines));
+  return TRUE;
+}
+
+// Checks that the snapshot in `data` was built out of the current contents of
+// the emoji file at `source_path`.
+static int belongs_to_source(const char *data, gsize size,
+                             const char *source_path,
+                             const SnapshotSource *source) {
+  if (size < sizeof(SnapshotHeader)) {
+    return FALSE;
+  }
+
+  const SnapshotHeader *header = (const SnapshotHeader *)data;
+  if (header->source_size != source->size ||
+      header->source_mtime != source->mtime ||
+      header->source_hash != source->hash ||
+      !section_fits(header->path_offset, (guint64)header->path_length + 1,
+                    size)) {
+    return FALSE;
+  }
+
+  // Names of snapshots are hashes of paths, which might collide.
+  const char *path = data + header->path_offset;
+  return header->path_length == strlen(source_path) &&
+         memcmp(path, source_path, header->path_length + 1) == 0;
+}
+
+/*
+ * Maps the snapshot at `path` and fills in `snapshot` with what was built out
+ * of the emoji file at `source_path` before, like `emoji_snapshot_map()`.
+ *
+ * Returns FALSE if the snapshot is missing, invalid, or does not belong to the
+ * emoji file as identified by `source`. The caller should then build
+ * everything from the emoji file, and can write a new snapshot.
+ */
+int read_emoji_snapshot(const char *path, const char *source_path,
+                        const SnapshotSource *source, Snapshot *snapshot) {
+  GMappedFile *file = g_mapped_file_new(path, FALSE, NULL);
+  if (file == NULL) {
+    return FALSE;
+  }
+
+  GBytes *bytes = g_mapped_file_get_bytes(file);
+  g_mapped_file_unref(file);
+
+  gsize size;
+  const char *data = g_bytes_get_data(bytes, &size);
+  int success = data != NULL &&
+                belongs_to_source(data, size, source_path, source) &&
+                emoji_snapshot_map(bytes, snapshot);
+
+  // What was mapped holds its own references.
+  g_bytes_unref(bytes);
+  return success;
+}
@@ -0,0 +1,42 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <glib.h>
+
+#include "emoji.h"
+#include "literal.h"
+#include "loader.h"
+#include "trigram.h"
+
+// Identifies the contents of an emoji file, so that a snapshot is only used
+// for the exact file it was built from.
+typedef struct {
+  guint64 size;
+  gint64 mtime;
+  guint64 hash;
+} SnapshotSource;
+
+// Everything the plugin builds out of an emoji file before it can search it.
+typedef struct {
+  EmojiTable *emojis;
+  // The matcher strings of every row, and the index of their trigrams.
+  LiteralMatcher *strings;
+  TrigramIndex *index;
+  // Lines of the emoji file that could not be parsed.
+  SkippedLines skipped;
+} Snapshot;
+
+char *emoji_snapshot_path(const char *source_path);
+int snapshot_source_identify(const char *source_path, SnapshotSource *source);
+
+void emoji_snapshot_append(const Snapshot *snapshot, const char *source_path,
+                           const SnapshotSource *source, GString *out);
+int emoji_snapshot_map(GBytes *bytes, Snapshot *snapshot);
+
+int write_emoji_snapshot(const Snapshot *snapshot, const char *source_path,
+                         const SnapshotSource *source, const char *path,
+                         char **error);
+int read_emoji_snapshot(const char *path, const char *source_path,
+                        const SnapshotSource *source, Snapshot *snapshot);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,360 @@
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trigram.h"
+
+// An inverted index from every three-byte sequence to the rows containing it,
+// ignoring ASCII case. Any string containing a literal also contains every
+// trigram of that literal, so intersecting their posting lists gives a small
+// set of candidate rows that then only has to be confirmed with a real match.
+
+// The rows of a trigram while the index is being built.
+typedef struct {
+  // Rows containing the trigram, in ascending order and without duplicates.
+  guint32 *rows;
+  guint32 len;
+  guint32 allocated;
+} PostingList;
+
+struct TrigramIndex {
+  // Distinct trigrams in ascending order. The rows containing `trigrams[t]`
+  // are `rows[offsets[t]]` up to (but not including) `rows[offsets[t + 1]]`.
+  const guint32 *trigrams;
+  const guint32 *offsets;
+  const guint32 *rows;
+  guint32 count;
+  unsigned int size;
+  // Caseless matching makes "k" match U+212A KELVIN SIGN and "s" match U+017F
+  // LATIN SMALL LETTER LONG S. Trigrams with those letters cannot be trusted
+  // if any of the strings contain them.
+  gboolean has_case_exceptions;
+  // The data the arrays point into, or NULL if they belong to the index.
+  GBytes *mapping;
+};
+
+// How `trigram_index_write()` stores an index, followed by its arrays.
+typedef struct {
+  guint32 size;
+  guint32 count;
+  guint32 row_count;
+  guint32 has_case_exceptions;
+} TrigramIndexHeader;
+
+static guint trigram_key(const char *p) {
+  return ((guint)(guchar)g_ascii_tolower(p[0]) << 16) |
+         ((guint)(guchar)g_ascii_tolower(p[1]) << 8) |
+         (guint)(guchar)g_ascii_tolower(p[2]);
+}
+
+static void posting_list_add(PostingList *list, guint32 row) {
+  // Rows are added in order, so a duplicate can only be the last row.
+  if (list->len > 0 && list->rows[list->len - 1] == row) {
+    return;
+  }
+
+  if (list->len == list->allocated) {
+    list->allocated = MAX(list->allocated * 2, 4);
+    list->rows = g_renew(guint32, list->rows, list->allocated);
+  }
+  list->rows[list->len++] = row;
+}
+
+static void posting_list_free(gpointer data) {
+  PostingList *list = data;
+  g_free(list->rows);
+  g_free(list);
+}
+
+static int compare_trigrams(const void *a, const void *b) {
+  guint32 x = *(const guint32 *)a;
+  guint32 y = *(const guint32 *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Indexes every trigram of `strings`, where the row of a string is its index.
+ */
+TrigramIndex *trigram_index_new(char *const *strings, unsigned int count) {
+  TrigramIndex *index = g_new(TrigramIndex, 1);
+  index->size = count;
+  index->has_case_exceptions = FALSE;
+  index->mapping = NULL;
+
+  // Posting lists are collected per trigram first, and then laid out back to
+  // back in the order of their trigrams.
+  GHashTable *postings = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL, posting_list_free);
+  guint32 row_count = 0;
+  for (unsigned int row = 0; row < count; ++row) {
+    const char *str = strings[row];
+    size_t length = strlen(str);
+
+    if (strstr(str, "\xe2\x84\xaa") != NULL ||
+        strstr(str, "\xc5\xbf") != NULL) {
+      index->has_case_exceptions = TRUE;
+    }
+
+    for (size_t i = 0; i + 3 <= length; ++i) {
+      gpointer key = GUINT_TO_POINTER(trigram_key(str + i));
+      PostingList *list = g_hash_table_lookup(postings, key);
+      if (list == NULL) {
+        list = g_new0(PostingList, 1);
+        g_hash_table_insert(postings, key, list);
+      }
+      guint32 len = list->len;
+      posting_list_add(list, row);
+      row_count += list->len - len;
+    }
+  }
+
+  guint32 trigram_count = g_hash_table_size(postings);
+  guint32 *trigrams = g_new(guint32, MAX(trigram_count, 1));
+  guint32 *offsets = g_new(guint32, trigram_count + 1);
+  guint32 *rows = g_new(guint32, MAX(row_count, 1));
+
+  GHashTableIter iter;
+  gpointer key;
+  guint32 t = 0;
+  g_hash_table_iter_init(&iter, postings);
+  while (g_hash_table_iter_next(&iter, &key, NULL)) {
+    trigrams[t++] = GPOINTER_TO_UINT(key);
+  }
+  qsort(trigrams, trigram_count, sizeof(guint32), compare_trigrams);
+
+  guint32 offset = 0;
+  for (t = 0; t < trigram_count; ++t) {
+    const PostingList *list =
+        g_hash_table_lookup(postings, GUINT_TO_POINTER(trigrams[t]));
+    offsets[t] = offset;
+    memcpy(rows + offset, list->rows, list->len * sizeof(guint32));
+    offset += list->len;
+  }
+  offsets[trigram_count] = offset;
+  g_hash_table_destroy(postings);
+
+  index->trigrams = trigrams;
+  index->offsets = offsets;
+  index->rows = rows;
+  index->count = trigram_count;
+  return index;
+}
+
+void trigram_index_free(TrigramIndex *index) {
+  if (index == NULL) {
+    return;
+  }
+
+  if (index->mapping != NULL) {
+    g_bytes_unref(index->mapping);
+  } else {
+    g_free((guint32 *)index->trigrams);
+    g_free((guint32 *)index->offsets);
+    g_free((guint32 *)index->rows);
+  }
+  g_free(index);
+}
+
+/*
+ * Appends the index to `out` in a form that `trigram_index_map()` can use
+ * without rebuilding it.
+ */
+void trigram_index_write(const TrigramIndex *index, GString *out) {
+  TrigramIndexHeader header = {
+      .size = index->size,
+      .count = index->count,
+      .row_count = index->offsets[index->count],
+      .has_case_exceptions = index->has_case_exceptions,
+  };
+  g_string_append_len(out, (const char *)&header, sizeof(header));
+  g_string_append_len(out, (const char *)index->trigrams,
+                      header.count * sizeof(guint32));
+  g_string_append_len(out, (const char *)index->offsets,
+                      (header.count + 1) * sizeof(guint32));
+  g_string_append_len(out, (const char *)index->rows,
+                      header.row_count * sizeof(guint32));
+}
+
+/*
+ * Uses the `length` bytes at `offset` in `bytes`, written by
+ * `trigram_index_write()`, as an index. The arrays are not copied, and the
+ * index keeps a reference to `bytes`.
+ *
+ * Returns NULL if the data is invalid, or does not index `count` strings.
+ */
+TrigramIndex *trigram_index_map(GBytes *bytes, gsize offset, gsize length,
+                                unsigned int count) {
+  gsize size;
+  const char *data = g_bytes_get_data(bytes, &size);
+  if (data == NULL || offset % sizeof(guint32) != 0 || offset + length > size ||
+      length < sizeof(TrigramIndexHeader)) {
+    return NULL;
+  }
+
+  const TrigramIndexHeader *header =
+      (const TrigramIndexHeader *)(data + offset);
+  if (header->size != count ||
+      (guint64)sizeof(TrigramIndexHeader) +
+          ((guint64)header->count * 2 + 1 + header->row_count) *
+              sizeof(guint32) !=
+      length) {
+    return NULL;
+  }
+
+  const guint32 *trigrams = (const guint32 *)(header + 1);
+  const guint32 *offsets = trigrams + header->count;
+  const guint32 *rows = offsets + header->count + 1;
+
+  // Lookups rely on trigrams and rows being in ascending order, and every
+  // row has to be in the bitsets they are collected in.
+  if (offsets[0] != 0 || offsets[header->count] != header->row_count) {
+    return NULL;
+  }
+  for (guint32 t = 0; t < header->count; ++t) {
+    if ((t > 0 && trigrams[t - 1] >= trigrams[t]) ||
+        offsets[t] > offsets[t + 1]) {
+      return NULL;
+    }
+  }
+  for (guint32 t = 0; t < header->count; ++t) {
+    for (guint32 i = offsets[t]; i < offsets[t + 1]; ++i) {
+      if (rows[i] >= header->size ||
+          (i > offsets[t] && rows[i - 1] >= rows[i])) {
+        return NULL;
+      }
+    }
+  }
+
+  TrigramIndex *index = g_new(TrigramIndex, 1);
+  index->trigrams = trigrams;
+  index->offsets = offsets;
+  index->rows = rows;
+  index->count = header->count;
+  index->size = header->size;
+  index->has_case_exceptions = header->has_case_exceptions;
+  index->mapping = g_bytes_ref(bytes);
+  return index;
+}
+
+// Returns TRUE if the trigram at `p` can be used to narrow down a search.
+static gboolean usable_trigram(const TrigramIndex *index, const char *p,
+                               gboolean caseless) {
+  if (!caseless) {
+    return TRUE;
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    char c = g_ascii_tolower(p[i]);
+    // Non-ASCII characters can match other byte sequences when ignoring case.
+    if ((guchar)c >= 0x80) {
+      return FALSE;
+    }
+    if (index->has_case_exceptions && (c == 'k' || c == 's')) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// The rows of a trigram, pointing into the index.
+typedef struct {
+  const guint32 *rows;
+  guint32 len;
+} Postings;
+
+// Finds the rows of the trigram at `p`. Returns FALSE if no row has it.
+static gboolean find_postings(const TrigramIndex *index, const char *p,
+                              Postings *postings) {
+  guint32 key = trigram_key(p);
+  guint32 low = 0;
+  guint32 high = index->count;
+  while (low < high) {
+    guint32 middle = low + (high - low) / 2;
+    if (index->trigrams[middle] < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (low == index->count || index->trigrams[low] != key) {
+    return FALSE;
+  }
+  postings->rows = index->rows + index->offsets[low];
+  postings->len = index->offsets[low + 1] - index->offsets[low];
+  return TRUE;
+}
+
+static gboolean postings_contain(const Postings *postings, guint32 row) {
+  guint32 low = 0;
+  guint32 high = postings->len;
+  while (low < high) {
+    guint32 middle = low + (high - low) / 2;
+    if (postings->rows[middle] < row) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low < postings->len && postings->rows[low] == row;
+}
+
+static gint compare_postings(gconstpointer a, gconstpointer b) {
+  const Postings *x = a;
+  const Postings *y = b;
+  return (x->len > y->len) - (x->len < y->len);
+}
+
+/*
+ * Returns the rows that might contain `literal`; every row that does is in the
+ * set. Returns NULL if the index cannot narrow down the rows at all, like for
+ * literals shorter than three bytes.
+ */
+Bitset *trigram_index_lookup(const TrigramIndex *index, const char *literal,
+                             gboolean caseless) {
+  size_t length = strlen(literal);
+  GArray *lists = g_array_new(FALSE, FALSE, sizeof(Postings));
+  gboolean missing = FALSE;
+
+  for (size_t i = 0; i + 3 <= length && !missing; ++i) {
+    if (!usable_trigram(index, literal + i, caseless)) {
+      continue;
+    }
+
+    Postings postings;
+    if (find_postings(index, literal + i, &postings)) {
+      g_array_append_val(lists, postings);
+    } else {
+      missing = TRUE;
+    }
+  }
+
+  if (lists->len == 0 && !missing) {
+    g_array_free(lists, TRUE);
+    return NULL;
+  }
+
+  Bitset *rows = bitset_new(index->size);
+  if (missing) {
+    g_array_free(lists, TRUE);
+    return rows;
+  }
+
+  // Start from the shortest list, and only keep rows that are found in every
+  // other list as well.
+  g_array_sort(lists, compare_postings);
+  const Postings *shortest = &g_array_index(lists, Postings, 0);
+  for (guint32 i = 0; i < shortest->len; ++i) {
+    guint32 row = shortest->rows[i];
+    gboolean found = TRUE;
+    for (guint j = 1; j < lists->len && found; ++j) {
+      found = postings_contain(&g_array_index(lists, Postings, j), row);
+    }
+    if (found) {
+      bitset_set(rows, row);
+    }
+  }
+
+  g_array_free(lists, TRUE);
+  return rows;
+}
@@ -0,0 +1,20 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <glib.h>
+
+#include "bitset.h"
+
+typedef struct TrigramIndex TrigramIndex;
+
+TrigramIndex *trigram_index_new(char *const *strings, unsigned int count);
+void trigram_index_free(TrigramIndex *index);
+
+void trigram_index_write(const TrigramIndex *index, GString *out);
+TrigramIndex *trigram_index_map(GBytes *bytes, gsize offset, gsize length,
+                                unsigned int count);
+
+Bitset *trigram_index_lookup(const TrigramIndex *index, const char *literal,
+                             gboolean caseless);
+
+#endif // TRIGRAM_H
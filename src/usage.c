@@ -0,0 +1,449 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bitset.h"
+#include "usage.h"
+#include "utils.h"
+
+// Every selected emoji is appended to a usage log in
+// `$XDG_DATA_HOME/rofi-emoji/`:
+//
+//   [header][record][record]...
+//
+// Records have a fixed size, so that recording a use is a single write and
+// reading the log is mapping it. A record stands for one or more uses of an
+// emoji of one emoji file, which count for less the older they are: half as
+// much every `HALF_LIFE` seconds. Once the log has `MAX_RECORDS` records, the
+// records of every emoji are merged into one, and emojis that hardly count
+// anymore are forgotten. This keeps the log small, however long it has been
+// used.
+//
+// Records of other emoji files are left alone, so that using `-emoji-file`
+// does not slow down launches with the bundled emojis, or the other way
+// around. Records of the emoji file in use that no longer point at their emoji
+// are fixed, or dropped if the emoji is gone, so that emojis only have to be
+// looked up once after the emoji file changed.
+
+#define USAGE_MAGIC "RFEMOUL"
+#define USAGE_VERSION 2
+
+#define HALF_LIFE (14 * 24 * 60 * 60)
+#define MIN_WEIGHT 0.01
+#define MAX_RECORDS 1024
+
+#define NO_ROW G_MAXUINT
+
+typedef struct {
+  char magic[8];
+  guint32 version;
+  guint32 record_size;
+} UsageHeader;
+
+typedef struct {
+  // Hash of the path of the emoji file, and of the emoji's bytes.
+  guint32 file;
+  guint32 emoji;
+  // Row of the emoji when it was last used. Only a hint, since the emoji file
+  // might have changed since.
+  guint32 row;
+  // Seconds since the Unix epoch.
+  guint32 time;
+  // Uses the record stands for as of `time`, which is 1 until records are
+  // merged.
+  float weight;
+} UsageRecord;
+
+typedef struct {
+  unsigned int row;
+  double score;
+} RowScore;
+
+/*
+ * Returns the path of the usage log in `$XDG_DATA_HOME/rofi-emoji/`.
+ */
+char *usage_log_path(void) {
+  return g_build_filename(g_get_user_data_dir(), "rofi-emoji", "usage", NULL);
+}
+
+// The bundled emojis have no path.
+static guint32 hash_file(const char *emoji_file) {
+  return hash_string(emoji_file != NULL ? emoji_file : "");
+}
+
+// What `weight` uses at `time` still count for at `now`.
+static double decay(double weight, guint32 time, gint64 now) {
+  if (now <= time) {
+    return weight;
+  }
+  return weight * exp2(-(double)(now - time) / HALF_LIFE);
+}
+
+static void init_header(UsageHeader *header) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, USAGE_MAGIC, sizeof(header->magic));
+  header->version = USAGE_VERSION;
+  header->record_size = sizeof(UsageRecord);
+}
+
+static gboolean is_usage_log(const char *data, gsize length) {
+  UsageHeader header;
+  UsageHeader expected;
+  if (length < sizeof(header)) {
+    return FALSE;
+  }
+  memcpy(&header, data, sizeof(header));
+  init_header(&expected);
+  return memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+// Returns the records of the log in `data`, leaving out a record that was only
+// written in part. Returns NULL if it is not a usage log.
+static const UsageRecord *log_records(const char *data, gsize length,
+                                      gsize *count) {
+  if (!is_usage_log(data, length)) {
+    *count = 0;
+    return NULL;
+  }
+  *count = (length - sizeof(UsageHeader)) / sizeof(UsageRecord);
+  return (const UsageRecord *)(data + sizeof(UsageHeader));
+}
+
+// Returns the row of the emoji of `record` in `emojis`, or NO_ROW if it is not
+// in there. Emojis that are no longer in the row they were used in are looked
+// up in `rows_by_emoji`, which is only built when it is first needed.
+static unsigned int find_row(const UsageRecord *record,
+                             const EmojiTable *emojis,
+                             GHashTable **rows_by_emoji) {
+  if (record->row < emojis->len &&
+      hash_string(emoji_table_bytes(emojis, record->row)) == record->emoji) {
+    return record->row;
+  }
+
+  if (*rows_by_emoji == NULL) {
+    *rows_by_emoji = g_hash_table_new(g_direct_hash, g_direct_equal);
+    // Backwards, so that the first row of an emoji that is listed twice wins.
+    for (unsigned int row = emojis->len; row-- > 0;) {
+      g_hash_table_insert(
+          *rows_by_emoji,
+          GUINT_TO_POINTER(hash_string(emoji_table_bytes(emojis, row))),
+          GUINT_TO_POINTER(row + 1));
+    }
+  }
+
+  gpointer row =
+      g_hash_table_lookup(*rows_by_emoji, GUINT_TO_POINTER(record->emoji));
+  return row != NULL ? GPOINTER_TO_UINT(row) - 1 : NO_ROW;
+}
+
+// Orders records by what they still count for at `*now`, highest first.
+static gint compare_records(gconstpointer a, gconstpointer b, gpointer now) {
+  const UsageRecord *first = a;
+  const UsageRecord *second = b;
+  double first_weight = decay(first->weight, first->time, *(gint64 *)now);
+  double second_weight = decay(second->weight, second->time, *(gint64 *)now);
+  return (first_weight < second_weight) - (first_weight > second_weight);
+}
+
+// Orders the records of every emoji next to each other, oldest first.
+static gint compare_emojis(gconstpointer a, gconstpointer b) {
+  const UsageRecord *first = a;
+  const UsageRecord *second = b;
+  if (first->file != second->file) {
+    return (first->file > second->file) - (first->file < second->file);
+  }
+  if (first->emoji != second->emoji) {
+    return (first->emoji > second->emoji) - (first->emoji < second->emoji);
+  }
+  return (first->time > second->time) - (first->time < second->time);
+}
+
+// Merges the records of every emoji into one, and leaves out emojis that hardly
+// count at `now` anymore. Records of `file` are looked up again in `emojis`, so
+// that they point at where the emojis are now, and are left out if the emoji
+// is gone.
+static GArray *merge_records(const UsageRecord *records, gsize count,
+                             guint32 file, const EmojiTable *emojis,
+                             gint64 now) {
+  GArray *sorted = g_array_sized_new(FALSE, FALSE, sizeof(UsageRecord), count);
+  g_array_append_vals(sorted, records, count);
+  g_array_sort(sorted, compare_emojis);
+
+  GArray *merged = g_array_new(FALSE, FALSE, sizeof(UsageRecord));
+  for (guint i = 0; i < sorted->len; ++i) {
+    const UsageRecord *record = &g_array_index(sorted, UsageRecord, i);
+    UsageRecord *into =
+        merged->len > 0
+            ? &g_array_index(merged, UsageRecord, merged->len - 1)
+            : NULL;
+    if (into == NULL || into->file != record->file ||
+        into->emoji != record->emoji) {
+      g_array_append_val(merged, *record);
+      continue;
+    }
+
+    // Both count as of the later use, which keeps what they count for at any
+    // later time the same.
+    into->weight = decay(into->weight, into->time, record->time) +
+                   record->weight;
+    into->time = record->time;
+    into->row = record->row;
+  }
+  g_array_free(sorted, TRUE);
+
+  GHashTable *rows_by_emoji = NULL;
+  guint kept = 0;
+  for (guint i = 0; i < merged->len; ++i) {
+    UsageRecord record = g_array_index(merged, UsageRecord, i);
+    if (decay(record.weight, record.time, now) < MIN_WEIGHT) {
+      continue;
+    }
+
+    // Emojis of other emoji files keep their rows.
+    if (record.file == file) {
+      record.row = find_row(&record, emojis, &rows_by_emoji);
+      if (record.row == NO_ROW) {
+        continue;
+      }
+    }
+    g_array_index(merged, UsageRecord, kept++) = record;
+  }
+  g_array_set_size(merged, kept);
+  if (rows_by_emoji != NULL) {
+    g_hash_table_destroy(rows_by_emoji);
+  }
+
+  // Leaves room for new records, even if lots of emojis are used all the time.
+  if (merged->len > MAX_RECORDS / 2) {
+    g_array_sort_with_data(merged, compare_records, &now);
+    g_array_set_size(merged, MAX_RECORDS / 2);
+  }
+  return merged;
+}
+
+// Replaces the log at `path` with one that has just `records`.
+static int write_usage_log(const char *path, const UsageRecord *records,
+                           gsize count, char **error) {
+  UsageHeader header;
+  init_header(&header);
+  GString *out = g_string_sized_new(sizeof(header) + count * sizeof(*records));
+  g_string_append_len(out, (const char *)&header, sizeof(header));
+  g_string_append_len(out, (const char *)records, count * sizeof(*records));
+
+  GError *write_error = NULL;
+  int success = g_file_set_contents(path, out->str, out->len, &write_error);
+  if (!success) {
+    *error = g_strdup_printf("Cannot write %s: %s", path, write_error->message);
+    g_error_free(write_error);
+  }
+
+  g_string_free(out, TRUE);
+  return success;
+}
+
+// Rewrites the log at `path` with the records of every emoji merged into one.
+// Anything that is not a usage log is replaced by an empty one.
+static int compact_usage_log(const char *path, guint32 file,
+                             const EmojiTable *emojis, gint64 now,
+                             char **error) {
+  char *data = NULL;
+  gsize length = 0;
+  g_file_get_contents(path, &data, &length, NULL);
+
+  gsize count;
+  const UsageRecord *records = log_records(data, length, &count);
+  GArray *merged = merge_records(records, count, file, emojis, now);
+  int success = write_usage_log(path, (const UsageRecord *)merged->data,
+                                merged->len, error);
+
+  g_array_free(merged, TRUE);
+  g_free(data);
+  return success;
+}
+
+static int compare_rows(const void *a, const void *b) {
+  const RowScore *first = a;
+  const RowScore *second = b;
+  return (first->row > second->row) - (first->row < second->row);
+}
+
+// Highest score first, and the earlier row of equal scores.
+static int compare_scores(const void *a, const void *b) {
+  const RowScore *first = a;
+  const RowScore *second = b;
+  if (first->score != second->score) {
+    return (first->score < second->score) - (first->score > second->score);
+  }
+  return compare_rows(a, b);
+}
+
+/*
+ * Reads the usage log at `path` and returns the rows of `emojis`, which were
+ * read from `emoji_file` (NULL for the bundled emojis), in the order to show
+ * them: the emojis that were used the most, and the most recently, as of `now`
+ * first, followed by all others in the order of the table.
+ *
+ * Returns NULL if none of the emojis were used, in which case the order of the
+ * table stays as it is.
+ */
+unsigned int *usage_log_rank(const char *path, const char *emoji_file,
+                             const EmojiTable *emojis, gint64 now) {
+  GMappedFile *mapped = g_mapped_file_new(path, FALSE, NULL);
+  if (mapped == NULL) {
+    return NULL;
+  }
+
+  gsize count;
+  const UsageRecord *records =
+      log_records(g_mapped_file_get_contents(mapped),
+                  g_mapped_file_get_length(mapped), &count);
+
+  guint32 file = hash_file(emoji_file);
+  GHashTable *rows_by_emoji = NULL;
+  gboolean moved = FALSE;
+  RowScore *scores = g_new(RowScore, MAX(count, 1));
+  gsize used = 0;
+  for (gsize i = 0; i < count; ++i) {
+    if (records[i].file != file) {
+      continue;
+    }
+
+    unsigned int row = find_row(&records[i], emojis, &rows_by_emoji);
+    moved |= row != records[i].row;
+    if (row != NO_ROW) {
+      scores[used].row = row;
+      scores[used].score = decay(records[i].weight, records[i].time, now);
+      used++;
+    }
+  }
+  g_mapped_file_unref(mapped);
+  if (rows_by_emoji != NULL) {
+    g_hash_table_destroy(rows_by_emoji);
+  }
+
+  // Adds up the records of every emoji.
+  qsort(scores, used, sizeof(RowScore), compare_rows);
+  gsize ranked = 0;
+  for (gsize i = 0; i < used; ++i) {
+    if (ranked > 0 && scores[ranked - 1].row == scores[i].row) {
+      scores[ranked - 1].score += scores[i].score;
+    } else {
+      scores[ranked++] = scores[i];
+    }
+  }
+
+  gsize kept = 0;
+  for (gsize i = 0; i < ranked; ++i) {
+    if (scores[i].score >= MIN_WEIGHT) {
+      scores[kept++] = scores[i];
+    }
+  }
+  qsort(scores, kept, sizeof(RowScore), compare_scores);
+
+  unsigned int *order = NULL;
+  if (kept > 0) {
+    order = g_new(unsigned int, emojis->len);
+    Bitset *is_ranked = bitset_new(emojis->len);
+    for (gsize i = 0; i < kept; ++i) {
+      order[i] = scores[i].row;
+      bitset_set(is_ranked, scores[i].row);
+    }
+    unsigned int line = kept;
+    for (unsigned int row = 0; row < emojis->len; ++row) {
+      if (!bitset_get(is_ranked, row)) {
+        order[line++] = row;
+      }
+    }
+    bitset_free(is_ranked);
+  }
+  g_free(scores);
+
+  // Records where the emojis are in the emoji file now, and forgets the ones
+  // that are gone, so that the next launch does not have to look for them
+  // again.
+  if (moved) {
+    char *error = NULL;
+    if (!compact_usage_log(path, file, emojis, now, &error)) {
+      g_warning("%s", error);
+      g_free(error);
+    }
+  }
+  return order;
+}
+
+/*
+ * Records in the usage log at `path` that the emoji in `row` of `emojis`, which
+ * were read from `emoji_file` (NULL for the bundled emojis), was used at `now`.
+ * Every so often, the log is compacted as well.
+ *
+ * Returns FALSE and sets `error` if the log cannot be written.
+ */
+int usage_log_append(const char *path, const char *emoji_file,
+                     const EmojiTable *emojis, unsigned int row, gint64 now,
+                     char **error) {
+  char *directory = g_path_get_dirname(path);
+  g_mkdir_with_parents(directory, 0700);
+  g_free(directory);
+
+  int fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    *error = g_strdup_printf("Cannot open %s: %s", path, g_strerror(errno));
+    return FALSE;
+  }
+
+  struct stat info;
+  gsize length = fstat(fd, &info) == 0 ? info.st_size : 0;
+  UsageHeader header;
+  gboolean is_valid =
+      pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+      is_usage_log((const char *)&header, sizeof(header)) &&
+      (length - sizeof(header)) % sizeof(UsageRecord) == 0;
+  if (length > 0 && !is_valid) {
+    // Not a usage log, or one that ends in a record that was only written in
+    // part. Either way, it is rewritten before anything is appended.
+    close(fd);
+    return compact_usage_log(path, hash_file(emoji_file), emojis, now,
+                             error) &&
+           usage_log_append(path, emoji_file, emojis, row, now, error);
+  }
+
+  UsageRecord record = {
+      .file = hash_file(emoji_file),
+      .emoji = hash_string(emoji_table_bytes(emojis, row)),
+      .row = row,
+      .time = now,
+      .weight = 1,
+  };
+
+  // A single write, so that launches at the same time never mix up records.
+  char buffer[sizeof(header) + sizeof(record)];
+  gsize size = 0;
+  if (length == 0) {
+    init_header(&header);
+    memcpy(buffer, &header, sizeof(header));
+    size = length = sizeof(header);
+  }
+  memcpy(buffer + size, &record, sizeof(record));
+  size += sizeof(record);
+
+  gboolean written = write(fd, buffer, size) == (ssize_t)size;
+  int write_errno = errno;
+  close(fd);
+  if (!written) {
+    *error =
+        g_strdup_printf("Cannot write %s: %s", path, g_strerror(write_errno));
+    return FALSE;
+  }
+
+  gsize count = (length - sizeof(header)) / sizeof(UsageRecord) + 1;
+  if (count >= MAX_RECORDS) {
+    return compact_usage_log(path, record.file, emojis, now, error);
+  }
+  return TRUE;
+}
@@ -0,0 +1,16 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <glib.h>
+
+#include "emoji.h"
+
+char *usage_log_path(void);
+
+unsigned int *usage_log_rank(const char *path, const char *emoji_file,
+                             const EmojiTable *emojis, gint64 now);
+int usage_log_append(const char *path, const char *emoji_file,
+                     const EmojiTable *emojis, unsigned int row, gint64 now,
+                     char **error);
+
+#endif // USAGE_H
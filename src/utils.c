@@ -1,7 +1,9 @@
 #include <errno.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -72,6 +74,19 @@ int find_clipboard_adapter(char **adapter, char **error) {
   return FALSE;
 }
 
+/*
+ * Returns the path of the file that the clipboard adapter logs its errors in
+ * when nobody is waiting for it, and creates its directory.
+ */
+char *clipboard_adapter_log_path(void) {
+  char *directory =
+      g_build_filename(g_get_user_cache_dir(), "rofi-emoji", NULL);
+  g_mkdir_with_parents(directory, 0700);
+  char *path = g_build_filename(directory, "clipboard-adapter.log", NULL);
+  g_free(directory);
+  return path;
+}
+
 int run_clipboard_adapter(const char *action, const char *text, char **error) {
   char *adapter;
   int ca_result = find_clipboard_adapter(&adapter, error);
@@ -278,9 +293,12 @@ void tokenize_search(const char *input, char **query, char **group_query,
   g_strstrip(*query);
 }
 
-char *codepoint(char *bytes) {
+/*
+ * Appends the codepoints of every character in `bytes` to `str`, formatted
+ * like "U+1F1F8 U+1F1EA".
+ */
+void append_codepoint(GString *str, const char *bytes) {
   int added = 0;
-  GString *str = g_string_new("");
 
   while (bytes[0] != '\0') {
     if (added > 0) {
@@ -293,13 +311,46 @@ char *codepoint(char *bytes) {
     } else if (c == -2) { // Incomplete
       g_string_append(str, "U+INCOMPLETE");
     } else {
-      char *formatted = g_strdup_printf("U+%04X", c);
-      g_string_append(str, formatted);
-      g_free(formatted);
+      g_string_append_printf(str, "U+%04X", c);
     }
     added++;
     bytes = g_utf8_find_next_char(bytes, NULL);
   }
+}
 
+char *codepoint(const char *bytes) {
+  GString *str = g_string_new("");
+  append_codepoint(str, bytes);
   return g_string_free(str, FALSE);
 }
+
+/*
+ * Hashes the NUL-terminated `str` with FNV-1a, which is quick for short
+ * strings like emojis, keywords and paths.
+ */
+guint32 hash_string(const char *str) {
+  guint32 hash = 2166136261u;
+  for (const guchar *c = (const guchar *)str; *c != '\0'; ++c) {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  return hash;
+}
+
+/*
+ * Hashes `length` bytes of `data` with 64-bit FNV-1a, taking eight bytes at a
+ * time. This is not the same hash as byte-wise FNV-1a, but is fast enough to
+ * hash whole files and still notices any change to them.
+ */
+guint64 hash_data(const char *data, gsize length) {
+  guint64 hash = 14695981039346656037u;
+  gsize i = 0;
+  for (; i + sizeof(guint64) <= length; i += sizeof(guint64)) {
+    guint64 word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * 1099511628211u;
+  }
+  for (; i < length; ++i) {
+    hash = (hash ^ (guchar)data[i]) * 1099511628211u;
+  }
+  return hash;
+}
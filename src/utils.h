@@ -18,12 +18,17 @@ typedef enum {
 
 FindDataFileResult find_data_file(const char *basename, char **path);
 int find_clipboard_adapter(char **adapter, char **error);
+char *clipboard_adapter_log_path(void);
 int run_clipboard_adapter(const char *action, const char *text, char **error);
 void capitalize(char *text);
 
 void tokenize_search(const char *input, char **query, char **group_query,
                      char **subgroup_query);
 
-char *codepoint(char *bytes);
+char *codepoint(const char *bytes);
+void append_codepoint(GString *str, const char *bytes);
+
+guint32 hash_string(const char *str);
+guint64 hash_data(const char *data, gsize length);
 
 #endif // UTILS_H
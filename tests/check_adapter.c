@@ -0,0 +1,375 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+
+#include "../src/adapter.h"
+
+static char *tmp_dir = NULL;
+static char *log_path = NULL;
+
+// Records every request it gets in `log_path`, and fails the "fail" action.
+// Like the real adapter, it only reads the lines of one request at a time.
+static const char *recording_adapter =
+    "#!/bin/sh\n"
+    "[ \"$1\" = serve ] || exit 2\n"
+    "while read -r request lines; do\n"
+    "  echo \"$request $lines\" >> \"$LOG\"\n"
+    "  while [ \"$lines\" -gt 0 ] && IFS= read -r line; do\n"
+    "    echo \"$line\" >> \"$LOG\"\n"
+    "    lines=$((lines - 1))\n"
+    "  done\n"
+    "  [ \"$request\" = fail ] && echo 3 || echo 0\n"
+    "done\n";
+
+// Stands in for `xsel`, recording what it would copy.
+static const char *recording_xsel = "#!/bin/sh\n"
+                                    "cat >> \"$LOG\"\n"
+                                    "printf '|' >> \"$LOG\"\n";
+
+static char *write_script(const char *name, const char *contents) {
+  char *path = g_build_filename(tmp_dir, name, NULL);
+  g_file_set_contents(path, contents, -1, NULL);
+  g_chmod(path, 0700);
+  return path;
+}
+
+static char *read_log(void) {
+  char *contents = NULL;
+  g_file_get_contents(log_path, &contents, NULL, NULL);
+  return contents != NULL ? contents : g_strdup("");
+}
+
+// Copies `text` with the real adapter, started for just that.
+static int copy_with_script(const char *text) {
+  gint status = -1;
+  g_spawn_sync(NULL,
+               (char *[]){"/bin/sh", "-c", "printf %s \"$1\" | \"$0\" copy",
+                          CLIPBOARD_ADAPTER, (char *)text, NULL},
+               NULL, G_SPAWN_DEFAULT, NULL, NULL, NULL, NULL, &status, NULL);
+  return status;
+}
+
+static void setup(void) {
+  tmp_dir = g_dir_make_tmp("rofi-emoji-XXXXXX", NULL);
+  log_path = g_build_filename(tmp_dir, "log", NULL);
+  g_setenv("LOG", log_path, TRUE);
+  // Where the real adapter remembers the tools it found.
+  g_setenv("XDG_RUNTIME_DIR", tmp_dir, TRUE);
+}
+
+static void teardown(void) {
+  char *tools_dir = g_build_filename(tmp_dir, "rofi-emoji", NULL);
+  char *tools_cache = g_build_filename(tools_dir, "tools", NULL);
+  g_unlink(tools_cache);
+  g_rmdir(tools_dir);
+  g_free(tools_cache);
+  g_free(tools_dir);
+
+  const char *name;
+  GDir *dir = g_dir_open(tmp_dir, 0, NULL);
+  while ((name = g_dir_read_name(dir)) != NULL) {
+    char *path = g_build_filename(tmp_dir, name, NULL);
+    g_unlink(path);
+    g_free(path);
+  }
+  g_dir_close(dir);
+  g_rmdir(tmp_dir);
+  g_free(log_path);
+  g_free(tmp_dir);
+}
+
+START_TEST(test_requests) {
+  char *path = write_script("adapter", recording_adapter);
+  char *error = NULL;
+  ClipboardAdapter *adapter = clipboard_adapter_start(path, NULL, &error);
+  ck_assert_ptr_ne(adapter, NULL);
+
+  ck_assert(clipboard_adapter_run(adapter, "copy", "😀", &error));
+  ck_assert_ptr_eq(error, NULL);
+
+  // Text can have spaces and newlines.
+  ck_assert(clipboard_adapter_run(adapter, "insert", "a b\n\n", &error));
+  ck_assert(clipboard_adapter_run(adapter, "insert_no_copy", "", &error));
+
+  ck_assert(!clipboard_adapter_run(adapter, "fail", "x", &error));
+  ck_assert_str_eq(error, "clipboard-adapter exited with 3");
+  g_free(error);
+
+  // A failed request does not stop the adapter.
+  ck_assert(clipboard_adapter_run(adapter, "copy", "🦄", &error));
+  clipboard_adapter_stop(adapter);
+
+  char *log = read_log();
+  ck_assert_str_eq(log, "copy 1\n😀\n"
+                        "insert 3\na b\n\n\n"
+                        "insert_no_copy 1\n\n"
+                        "fail 1\nx\n"
+                        "copy 1\n🦄\n");
+  g_free(log);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_adapter_exited) {
+  char *path = write_script("adapter", "#!/bin/sh\nexit 0\n");
+  char *error = NULL;
+  ClipboardAdapter *adapter = clipboard_adapter_start(path, NULL, &error);
+  ck_assert_ptr_ne(adapter, NULL);
+
+  // Enough text to fill up the pipe, which must not end the process with a
+  // SIGPIPE either.
+  char *text = g_strnfill(1024 * 1024, 'x');
+  ck_assert(!clipboard_adapter_run(adapter, "copy", text, &error));
+  ck_assert_str_eq(error, "clipboard-adapter stopped unexpectedly");
+  g_free(error);
+
+  clipboard_adapter_stop(adapter);
+  g_free(text);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_send) {
+  char *path = write_script("adapter", recording_adapter);
+  char *error = NULL;
+  ClipboardAdapter *adapter = clipboard_adapter_start(path, NULL, &error);
+  ck_assert_ptr_ne(adapter, NULL);
+
+  // Nothing is heard about requests that are only sent.
+  ck_assert(clipboard_adapter_send(adapter, "fail", "x", &error));
+  ck_assert_ptr_eq(error, NULL);
+  ck_assert(clipboard_adapter_send(adapter, "insert", "😀", &error));
+
+  // Their responses are not taken for the ones of later requests.
+  ck_assert(clipboard_adapter_run(adapter, "copy", "🦄", &error));
+  ck_assert(!clipboard_adapter_run(adapter, "fail", "y", &error));
+  g_free(error);
+  clipboard_adapter_stop(adapter);
+
+  char *log = read_log();
+  ck_assert_str_eq(log, "fail 1\nx\n"
+                        "insert 1\n😀\n"
+                        "copy 1\n🦄\n"
+                        "fail 1\ny\n");
+  g_free(log);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_stop_after_send) {
+  // Takes its time with the second request.
+  char *path = write_script("adapter", "#!/bin/sh\n"
+                                       "read -r request lines\n"
+                                       "read -r text\n"
+                                       "echo 0\n"
+                                       "read -r request lines\n"
+                                       "read -r text\n"
+                                       "sleep 2\n"
+                                       "echo 0\n");
+  char *error = NULL;
+  ClipboardAdapter *adapter = clipboard_adapter_start(path, NULL, &error);
+  ck_assert_ptr_ne(adapter, NULL);
+  ck_assert(clipboard_adapter_run(adapter, "copy", "😀", &error));
+  ck_assert(clipboard_adapter_send(adapter, "insert", "😀", &error));
+
+  // The adapter is left to finish on its own.
+  gint64 start = g_get_monotonic_time();
+  clipboard_adapter_stop(adapter);
+  ck_assert_int_lt(g_get_monotonic_time() - start, G_USEC_PER_SEC);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_stop_stuck_adapter) {
+  // Never gets to reading requests, like one stuck looking for the tools.
+  char *path = write_script("adapter", "#!/bin/sh\nsleep 5\n");
+  char *error = NULL;
+  ClipboardAdapter *adapter = clipboard_adapter_start(path, NULL, &error);
+  ck_assert_ptr_ne(adapter, NULL);
+
+  gint64 start = g_get_monotonic_time();
+  clipboard_adapter_stop(adapter);
+  ck_assert_int_lt(g_get_monotonic_time() - start, G_USEC_PER_SEC);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_run_detached) {
+  char *path = write_script("adapter", "#!/bin/sh\n"
+                                       "echo \"error from $1\" >&2\n"
+                                       "sleep 1\n"
+                                       "echo \"$1 $(cat)\" >> \"$LOG\"\n");
+  char *errors_path = g_build_filename(tmp_dir, "errors", NULL);
+  char *error = NULL;
+
+  // Returns before the adapter is done.
+  gint64 start = g_get_monotonic_time();
+  ck_assert(clipboard_adapter_run_detached(path, "insert", "😀", errors_path,
+                                           &error));
+  ck_assert_ptr_eq(error, NULL);
+  ck_assert_int_lt(g_get_monotonic_time() - start, G_USEC_PER_SEC);
+
+  char *log = read_log();
+  for (int i = 0; i < 100 && *log == '\0'; ++i) {
+    g_usleep(G_USEC_PER_SEC / 10);
+    g_free(log);
+    log = read_log();
+  }
+  ck_assert_str_eq(log, "insert 😀\n");
+
+  char *errors = NULL;
+  g_file_get_contents(errors_path, &errors, NULL, NULL);
+  ck_assert_str_eq(errors, "error from insert\n");
+
+  g_free(errors);
+  g_free(log);
+  g_free(errors_path);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_missing_adapter) {
+  char *path = g_build_filename(tmp_dir, "missing", NULL);
+  char *error = NULL;
+  ck_assert_ptr_eq(clipboard_adapter_start(path, NULL, &error), NULL);
+  ck_assert(g_str_has_prefix(error, "Failed to run clipboard-adapter: "));
+  g_free(error);
+
+  ck_assert(!clipboard_adapter_run_detached(path, "copy", "😀", log_path,
+                                            &error));
+  ck_assert(g_str_has_prefix(error, "Failed to run clipboard-adapter: "));
+  g_free(error);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_clipboard_adapter_script) {
+  char *xsel = write_script("xsel", recording_xsel);
+  char *search_path = g_strconcat(tmp_dir, ":", g_getenv("PATH"), NULL);
+  g_setenv("PATH", search_path, TRUE);
+  g_setenv("XDG_SESSION_TYPE", "x11", TRUE);
+  g_unsetenv("WAYLAND_DISPLAY");
+
+  char *error = NULL;
+  ClipboardAdapter *adapter =
+      clipboard_adapter_start(CLIPBOARD_ADAPTER, NULL, &error);
+  ck_assert_ptr_ne(adapter, NULL);
+
+  ck_assert(clipboard_adapter_run(adapter, "copy", "😀", &error));
+  ck_assert(clipboard_adapter_run(adapter, "copy", "two\nlines\n", &error));
+
+  // The tools are looked for once, when the adapter starts.
+  g_unlink(xsel);
+  ck_assert(clipboard_adapter_run(adapter, "copy", "🦄", &error) == FALSE);
+  ck_assert_str_eq(error, "clipboard-adapter exited with 127");
+  g_free(error);
+  clipboard_adapter_stop(adapter);
+
+  char *log = read_log();
+  ck_assert_str_eq(log, "😀|two\nlines\n|");
+  g_free(log);
+  g_free(search_path);
+  g_free(xsel);
+}
+END_TEST
+
+START_TEST(test_tools_cache) {
+  char *search_path = g_strconcat(tmp_dir, ":", g_getenv("PATH"), NULL);
+  g_setenv("PATH", search_path, TRUE);
+  g_setenv("XDG_SESSION_TYPE", "x11", TRUE);
+  g_setenv("DISPLAY", ":0", TRUE);
+  g_unsetenv("WAYLAND_DISPLAY");
+
+  char *xclip = write_script("xclip", "#!/bin/sh\n"
+                                      "echo \"xclip $(cat)\" >> \"$LOG\"\n");
+  ck_assert_int_eq(copy_with_script("😀"), 0);
+
+  // A better tool is only looked for once the session changes.
+  char *xsel = write_script("xsel", "#!/bin/sh\n"
+                                    "echo \"xsel $(cat)\" >> \"$LOG\"\n");
+  ck_assert_int_eq(copy_with_script("🦄"), 0);
+  g_setenv("DISPLAY", ":1", TRUE);
+  ck_assert_int_eq(copy_with_script("🐶"), 0);
+
+  // Or when the one that was found is gone.
+  g_unlink(xsel);
+  ck_assert_int_eq(copy_with_script("🐱"), 0);
+
+  char *log = read_log();
+  ck_assert_str_eq(log, "xclip 😀\n"
+                        "xclip 🦄\n"
+                        "xsel 🐶\n"
+                        "xclip 🐱\n");
+
+  g_free(log);
+  g_free(xsel);
+  g_free(xclip);
+  g_free(search_path);
+}
+END_TEST
+
+START_TEST(test_detect) {
+  char *search_path = g_strconcat(tmp_dir, ":", g_getenv("PATH"), NULL);
+  g_setenv("PATH", search_path, TRUE);
+  g_setenv("WAYLAND_DISPLAY", "wayland-0", TRUE);
+  char *wl_copy = write_script("wl-copy", "#!/bin/sh\n");
+
+  char *out = NULL;
+  gint status;
+  ck_assert(g_spawn_sync(NULL, (char *[]){CLIPBOARD_ADAPTER, "--detect", NULL},
+                         NULL, G_SPAWN_DEFAULT, NULL, NULL, &out, NULL,
+                         &status, NULL));
+  ck_assert(g_str_has_prefix(out, "Session: Wayland\n"
+                                  "Copy tool: wl-copy\n"));
+
+  // What was found is remembered.
+  char *tools_cache =
+      g_build_filename(tmp_dir, "rofi-emoji", "tools", NULL);
+  ck_assert(g_file_test(tools_cache, G_FILE_TEST_IS_REGULAR));
+
+  g_free(tools_cache);
+  g_free(out);
+  g_free(wl_copy);
+  g_free(search_path);
+}
+END_TEST
+
+Suite *adapter_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Adapter");
+  tc_core = tcase_create("Core");
+
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, test_requests);
+  tcase_add_test(tc_core, test_adapter_exited);
+  tcase_add_test(tc_core, test_send);
+  tcase_add_test(tc_core, test_stop_after_send);
+  tcase_add_test(tc_core, test_stop_stuck_adapter);
+  tcase_add_test(tc_core, test_run_detached);
+  tcase_add_test(tc_core, test_missing_adapter);
+  tcase_add_test(tc_core, test_clipboard_adapter_script);
+  tcase_add_test(tc_core, test_tools_cache);
+  tcase_add_test(tc_core, test_detect);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = adapter_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
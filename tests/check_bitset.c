@@ -0,0 +1,117 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/bitset.h"
+
+START_TEST(test_set_and_get) {
+  Bitset *bitset = bitset_new(130);
+
+  ck_assert_int_eq(bitset_count(bitset), 0);
+
+  bitset_set(bitset, 0);
+  bitset_set(bitset, 63);
+  bitset_set(bitset, 64);
+  bitset_set(bitset, 129);
+
+  ck_assert(bitset_get(bitset, 0));
+  ck_assert(!bitset_get(bitset, 1));
+  ck_assert(bitset_get(bitset, 63));
+  ck_assert(bitset_get(bitset, 64));
+  ck_assert(bitset_get(bitset, 129));
+  ck_assert_int_eq(bitset_count(bitset), 4);
+
+  bitset_free(bitset);
+}
+END_TEST
+
+START_TEST(test_fill_and_and) {
+  Bitset *all = bitset_new(70);
+  bitset_fill(all);
+
+  // Bits past the end are never set.
+  ck_assert_int_eq(bitset_count(all), 70);
+
+  Bitset *some = bitset_new(70);
+  bitset_set(some, 3);
+  bitset_set(some, 69);
+
+  Bitset *copy = bitset_copy(all);
+  bitset_and(copy, some);
+  ck_assert_int_eq(bitset_count(copy), 2);
+  ck_assert(bitset_get(copy, 69));
+
+  // The copy is independent of the original.
+  ck_assert_int_eq(bitset_count(all), 70);
+
+  bitset_free(all);
+  bitset_free(some);
+  bitset_free(copy);
+}
+END_TEST
+
+START_TEST(test_empty) {
+  Bitset *bitset = bitset_new(0);
+  bitset_fill(bitset);
+  ck_assert_int_eq(bitset_count(bitset), 0);
+  bitset_free(bitset);
+}
+END_TEST
+
+START_TEST(test_next) {
+  Bitset *bitset = bitset_new(200);
+  bitset_set(bitset, 3);
+  bitset_set(bitset, 64);
+  bitset_set(bitset, 199);
+
+  ck_assert_int_eq(bitset_next(bitset, 0), 3);
+  ck_assert_int_eq(bitset_next(bitset, 3), 3);
+  ck_assert_int_eq(bitset_next(bitset, 4), 64);
+  ck_assert_int_eq(bitset_next(bitset, 65), 199);
+  ck_assert_int_eq(bitset_next(bitset, 200), 200);
+
+  ck_assert_int_eq(bitset_next_before(bitset, 4, 64), 64);
+  ck_assert_int_eq(bitset_next_before(bitset, 4, 65), 64);
+  ck_assert_int_eq(bitset_next_before(bitset, 65, 199), 199);
+
+  unsigned int count = 0;
+  for (unsigned int i = bitset_next(bitset, 0); i < bitset->size;
+       i = bitset_next(bitset, i + 1)) {
+    count++;
+  }
+  ck_assert_int_eq(count, 3);
+
+  bitset_free(bitset);
+}
+END_TEST
+
+Suite *bitset_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Bitset");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_set_and_get);
+  tcase_add_test(tc_core, test_fill_and_and);
+  tcase_add_test(tc_core, test_empty);
+  tcase_add_test(tc_core, test_next);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = bitset_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/cache.h"
+
+static Cache *new_string_cache(gsize budget) {
+  return cache_new(budget, g_str_hash, g_str_equal, g_free, g_free);
+}
+
+START_TEST(test_cache_lookup) {
+  Cache *cache = new_string_cache(10);
+
+  ck_assert_ptr_eq(cache_lookup(cache, "a"), NULL);
+  cache_insert(cache, g_strdup("a"), g_strdup("first"), 1);
+  ck_assert_str_eq(cache_lookup(cache, "a"), "first");
+
+  // Inserting an existing key replaces its value.
+  cache_insert(cache, g_strdup("a"), g_strdup("second"), 1);
+  ck_assert_str_eq(cache_lookup(cache, "a"), "second");
+  ck_assert_int_eq(cache->cost, 1);
+
+  ck_assert_int_eq(cache->hits, 2);
+  ck_assert_int_eq(cache->misses, 1);
+
+  cache_free(cache);
+}
+END_TEST
+
+START_TEST(test_cache_eviction) {
+  Cache *cache = new_string_cache(3);
+
+  cache_insert(cache, g_strdup("a"), g_strdup("1"), 1);
+  cache_insert(cache, g_strdup("b"), g_strdup("2"), 1);
+  cache_insert(cache, g_strdup("c"), g_strdup("3"), 1);
+
+  // Using "a" makes "b" the least recently used entry.
+  ck_assert_ptr_ne(cache_lookup(cache, "a"), NULL);
+  cache_insert(cache, g_strdup("d"), g_strdup("4"), 1);
+
+  ck_assert_ptr_eq(cache_lookup(cache, "b"), NULL);
+  ck_assert_ptr_ne(cache_lookup(cache, "a"), NULL);
+  ck_assert_ptr_ne(cache_lookup(cache, "c"), NULL);
+  ck_assert_ptr_ne(cache_lookup(cache, "d"), NULL);
+
+  // Expensive entries evict as many entries as needed.
+  cache_insert(cache, g_strdup("e"), g_strdup("5"), 2);
+  ck_assert_int_eq(cache->cost, 3);
+  ck_assert_ptr_eq(cache_lookup(cache, "a"), NULL);
+  ck_assert_ptr_eq(cache_lookup(cache, "c"), NULL);
+  ck_assert_ptr_ne(cache_lookup(cache, "d"), NULL);
+
+  // Entries larger than the whole budget are never stored.
+  cache_insert(cache, g_strdup("f"), g_strdup("6"), 4);
+  ck_assert_ptr_eq(cache_lookup(cache, "f"), NULL);
+  ck_assert_int_eq(cache->cost, 3);
+
+  cache_clear(cache);
+  ck_assert_int_eq(cache->cost, 0);
+  ck_assert_ptr_eq(cache_lookup(cache, "d"), NULL);
+
+  cache_free(cache);
+}
+END_TEST
+
+Suite *cache_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Cache");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_cache_lookup);
+  tcase_add_test(tc_core, test_cache_eviction);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = cache_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,164 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/database.h"
+#include "../src/loader.h"
+
+static char *tmp_dir = NULL;
+static char *source_path = NULL;
+static gsize source_size = 0;
+
+static void setup(void) {
+  tmp_dir = g_dir_make_tmp("rofi-emoji-XXXXXX", NULL);
+  source_path = g_build_filename(tmp_dir, "emojis.txt", NULL);
+
+  const char *contents =
+      "😀\tSmileys & Emotion\tface-smiling\tgrinning face\tface | grin\n"
+      "🦄\tAnimals & Nature\tanimal-mammal\tunicorn\tface | unicorn\n"
+      "🐶\tAnimals & Nature\tanimal-mammal\tdog face\tdog | pet\n";
+  source_size = strlen(contents);
+  g_file_set_contents(source_path, contents, -1, NULL);
+}
+
+static void teardown(void) {
+  g_unlink(source_path);
+  g_rmdir(tmp_dir);
+  g_free(source_path);
+  g_free(tmp_dir);
+}
+
+// Returns the emojis of the text file in the database format, after `padding`
+// zero bytes.
+static GBytes *compile(gsize padding) {
+  EmojiTable *emojis = read_emojis_from_file(source_path, NULL);
+  GString *out = g_string_new(NULL);
+  for (gsize i = 0; i < padding; ++i) {
+    g_string_append_c(out, '\0');
+  }
+  emoji_database_append(emojis, source_size, out);
+  emoji_table_free(emojis);
+  return g_string_free_to_bytes(out);
+}
+
+START_TEST(test_round_trip) {
+  GBytes *bytes = compile(0);
+  EmojiTable *emojis =
+      emoji_database_map(bytes, 0, g_bytes_get_size(bytes), source_size);
+  g_bytes_unref(bytes);
+  ck_assert_ptr_ne(emojis, NULL);
+  ck_assert_ptr_ne(emojis->database, NULL);
+  ck_assert_int_eq(emojis->len, 3);
+
+  ck_assert_str_eq(emoji_table_bytes(emojis, 1), "🦄");
+  ck_assert_str_eq(emoji_table_name(emojis, 1), "Unicorn");
+  ck_assert_str_eq(emoji_table_group(emojis, 1), "Animals & Nature");
+  ck_assert_str_eq(emoji_table_subgroup(emojis, 1), "Animal-mammal");
+  ck_assert_int_eq(emoji_table_keyword_count(emojis, 1), 1);
+  ck_assert_str_eq(emoji_table_keyword(emojis, 1, 0), "Face");
+
+  // The table is used straight from the bytes, which it keeps alive.
+  gsize length;
+  const char *data = g_bytes_get_data(emojis->database, &length);
+  ck_assert((const char *)emojis->names > data &&
+            (const char *)emojis->names < data + length);
+  ck_assert(emojis->strings > data && emojis->strings < data + length);
+
+  // Identical strings are stored once in the string pool.
+  ck_assert_ptr_eq(emoji_table_group(emojis, 1), emoji_table_group(emojis, 2));
+  ck_assert_ptr_eq(emoji_table_subgroup(emojis, 1),
+                   emoji_table_subgroup(emojis, 2));
+  ck_assert_int_eq(emojis->group_ids[1], emojis->group_ids[2]);
+  ck_assert_int_eq(emojis->groups->len, 2);
+  ck_assert_int_eq(emojis->subgroups->len, 2);
+
+  // So are keywords, which keep their IDs.
+  ck_assert_int_eq(emojis->keywords->keywords->len, 4);
+  ck_assert_int_eq(emojis->keyword_ids[emojis->keyword_offsets[1]],
+                   emojis->keyword_ids[emojis->keyword_offsets[0]]);
+  ck_assert_str_eq(emoji_table_keyword(emojis, 2, 1), "Pet");
+
+  emoji_table_free(emojis);
+}
+END_TEST
+
+START_TEST(test_offset) {
+  GBytes *bytes = compile(8);
+  gsize length = g_bytes_get_size(bytes) - 8;
+
+  EmojiTable *emojis = emoji_database_map(bytes, 8, length, source_size);
+  ck_assert_ptr_ne(emojis, NULL);
+  ck_assert_str_eq(emoji_table_name(emojis, 2), "Dog face");
+  emoji_table_free(emojis);
+
+  // Sections must stay aligned, and inside of the bytes.
+  ck_assert_ptr_eq(emoji_database_map(bytes, 4, length, source_size), NULL);
+  ck_assert_ptr_eq(emoji_database_map(bytes, 8, length + 8, source_size),
+                   NULL);
+
+  g_bytes_unref(bytes);
+}
+END_TEST
+
+START_TEST(test_other_source) {
+  // The text file is the source of truth. A database written for a file of
+  // another size is not used.
+  GBytes *bytes = compile(0);
+  EmojiTable *emojis =
+      emoji_database_map(bytes, 0, g_bytes_get_size(bytes), source_size + 1);
+  ck_assert_ptr_eq(emojis, NULL);
+  g_bytes_unref(bytes);
+}
+END_TEST
+
+START_TEST(test_corrupt_database) {
+  GBytes *bytes = compile(0);
+
+  // Truncated in the middle of the string pool.
+  EmojiTable *emojis =
+      emoji_database_map(bytes, 0, g_bytes_get_size(bytes) - 4, source_size);
+  ck_assert_ptr_eq(emojis, NULL);
+  g_bytes_unref(bytes);
+
+  // Garbage instead of a header.
+  const char garbage[64] = "not a database";
+  bytes = g_bytes_new(garbage, sizeof(garbage));
+  emojis = emoji_database_map(bytes, 0, sizeof(garbage), source_size);
+  ck_assert_ptr_eq(emojis, NULL);
+  g_bytes_unref(bytes);
+}
+END_TEST
+
+Suite *database_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Database");
+  tc_core = tcase_create("Core");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, test_round_trip);
+  tcase_add_test(tc_core, test_offset);
+  tcase_add_test(tc_core, test_other_source);
+  tcase_add_test(tc_core, test_corrupt_database);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = database_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
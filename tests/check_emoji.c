@@ -4,29 +4,120 @@
 
 #include "../src/emoji.h"
 
-START_TEST(test_new_and_free) {
-  char *keywords[4] = {"kw1", "kw2 - electric buggaloo", NULL};
-
-  // Accepts owned data
-  // clang-format off
-  Emoji *emoji = emoji_new(
-    g_strdup("😀"),
-    g_strdup("smiling"),
-    g_strdup("people"),
-    g_strdup("faces"),
-    g_strdupv(keywords)
-  );
-  // clang-format on
-
-  ck_assert_str_eq(emoji->bytes, "😀");
-  ck_assert_str_eq(emoji->name, "smiling");
-  ck_assert_str_eq(emoji->group, "people");
-  ck_assert_str_eq(emoji->subgroup, "faces");
-  ck_assert_str_eq(emoji->keywords[0], "kw1");
-  ck_assert_str_eq(emoji->keywords[1], "kw2 - electric buggaloo");
-  ck_assert_ptr_eq(emoji->keywords[2], NULL);
-
-  emoji_free(emoji);
+START_TEST(test_table) {
+  EmojiTable *table = emoji_table_new(1);
+  ck_assert_int_eq(table->len, 0);
+  ck_assert_int_eq(table->keyword_offsets[0], 0);
+
+  unsigned int group = emoji_table_add_group(table, "Smileys");
+  unsigned int subgroup = emoji_table_add_subgroup(table, "Face-smiling");
+  guint32 keyword_ids[] = {keyword_dictionary_add(table->keywords, "Face"),
+                           keyword_dictionary_add(table->keywords, "Grin")};
+
+  // Grows past the reserved size; strings are copied into the table.
+  char name[] = "smiling";
+  for (unsigned int i = 0; i < 100; ++i) {
+    ck_assert_int_eq(emoji_table_add(table, "😀", name, group, subgroup,
+                                     keyword_ids, i % 3),
+                     i);
+  }
+  name[0] = 'S';
+
+  ck_assert_int_eq(table->len, 100);
+  ck_assert_str_eq(emoji_table_bytes(table, 99), "😀");
+  ck_assert_str_eq(emoji_table_name(table, 99), "smiling");
+  ck_assert_str_eq(emoji_table_group(table, 99), "Smileys");
+  ck_assert_str_eq(emoji_table_subgroup(table, 99), "Face-smiling");
+
+  // Keywords of every row are a range of the table's keyword IDs.
+  ck_assert_int_eq(emoji_table_keyword_count(table, 0), 0);
+  ck_assert_int_eq(emoji_table_keyword_count(table, 98), 2);
+  ck_assert_str_eq(emoji_table_keyword(table, 98, 1), "Grin");
+  ck_assert_int_eq(emoji_table_keyword_count(table, 99), 0);
+  ck_assert_int_eq(table->keyword_offsets[100], 99);
+
+  emoji_table_free(table);
+}
+END_TEST
+
+START_TEST(test_arena_alignment) {
+  Arena *arena = arena_new();
+
+  arena_alloc(arena, 3);
+  void *aligned = arena_alloc(arena, sizeof(char *));
+  ck_assert_int_eq((gsize)aligned % sizeof(void *), 0);
+
+  // Allocations larger than a block are still served.
+  char *large = arena_alloc(arena, 1024 * 1024);
+  large[1024 * 1024 - 1] = 'x';
+  ck_assert_ptr_ne(arena_strdup(arena, "after"), NULL);
+
+  arena_free(arena);
+}
+END_TEST
+
+START_TEST(test_table_append) {
+  EmojiTable *table = emoji_table_new(1);
+  guint32 face = keyword_dictionary_add(table->keywords, "Face");
+  emoji_table_add(table, "😀", "grinning",
+                  emoji_table_add_group(table, "Smileys"),
+                  emoji_table_add_subgroup(table, "Face-smiling"), &face, 1);
+
+  EmojiTable *from = emoji_table_new(1);
+  guint32 keywords[] = {keyword_dictionary_add(from->keywords, "Horse"),
+                        keyword_dictionary_add(from->keywords, "Face")};
+  emoji_table_add(from, "🦄", "unicorn",
+                  emoji_table_add_group(from, "Animals"),
+                  emoji_table_add_subgroup(from, "Animal-mammal"), keywords, 2);
+  emoji_table_add(from, "😺", "grinning cat",
+                  emoji_table_add_group(from, "Smileys"),
+                  emoji_table_add_subgroup(from, "Cat-face"), NULL, 0);
+
+  emoji_table_append(table, from);
+  emoji_table_free(from);
+
+  // Groups, subgroups and keywords that were already in the table are shared.
+  ck_assert_int_eq(table->len, 3);
+  ck_assert_int_eq(table->groups->len, 2);
+  ck_assert_int_eq(table->subgroups->len, 3);
+  ck_assert_int_eq(table->keywords->keywords->len, 2);
+
+  ck_assert_str_eq(emoji_table_bytes(table, 1), "🦄");
+  ck_assert_str_eq(emoji_table_name(table, 1), "unicorn");
+  ck_assert_str_eq(emoji_table_group(table, 1), "Animals");
+  ck_assert_str_eq(emoji_table_subgroup(table, 1), "Animal-mammal");
+  ck_assert_int_eq(emoji_table_keyword_count(table, 1), 2);
+  ck_assert_str_eq(emoji_table_keyword(table, 1, 0), "Horse");
+  ck_assert_int_eq(table->keyword_ids[2], face);
+
+  ck_assert_str_eq(emoji_table_name(table, 2), "grinning cat");
+  ck_assert_int_eq(table->group_ids[2], table->group_ids[0]);
+  ck_assert_int_eq(emoji_table_keyword_count(table, 2), 0);
+  ck_assert_int_eq(table->keyword_offsets[3], 3);
+
+  emoji_table_free(table);
+}
+END_TEST
+
+START_TEST(test_table_interning) {
+  EmojiTable *table = emoji_table_new(4);
+
+  char first[] = "Animals & Nature";
+  char second[] = "Animals & Nature";
+
+  unsigned int id = emoji_table_intern_group(table, first);
+  ck_assert_int_eq(emoji_table_intern_group(table, second), id);
+  ck_assert_int_ne(emoji_table_intern_group(table, "Symbols"), id);
+  ck_assert_int_eq(table->groups->len, 2);
+
+  // The first string seen is the one that is shared.
+  ck_assert_ptr_eq(g_ptr_array_index(table->groups, id), first);
+
+  // Subgroups have their own IDs.
+  ck_assert_int_eq(emoji_table_intern_subgroup(table, "Animal-mammal"), 0);
+  ck_assert_int_eq(table->subgroups->len, 1);
+
+  emoji_table_free(table);
 }
 END_TEST
 
@@ -37,7 +128,10 @@ Suite *emoji_suite(void) {
   s = suite_create("Emoji");
   tc_model = tcase_create("Model");
 
-  tcase_add_test(tc_model, test_new_and_free);
+  tcase_add_test(tc_model, test_table);
+  tcase_add_test(tc_model, test_table_interning);
+  tcase_add_test(tc_model, test_arena_alignment);
+  tcase_add_test(tc_model, test_table_append);
   suite_add_tcase(s, tc_model);
 
   return s;
@@ -0,0 +1,132 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/formatter.h"
+
+// The emojis the tests format, by row.
+enum {
+  GRINNING,
+  SPECIAL_KEYWORDS,
+  NO_KEYWORDS,
+  UNICORN,
+};
+
+static EmojiTable *table = NULL;
+
+// Adds an emoji with the keywords in the NULL-terminated `keywords`.
+static void add_emoji(const char *bytes, const char *name, char **keywords) {
+  guint32 ids[8];
+  unsigned int count = 0;
+  for (; keywords[count] != NULL; ++count) {
+    ids[count] = keyword_dictionary_add(table->keywords, keywords[count]);
+  }
+
+  emoji_table_add(table, bytes, name,
+                  emoji_table_add_group(table, "Smileys & Emotion"),
+                  emoji_table_add_subgroup(table, "Face-smiling"), ids, count);
+}
+
+static void setup(void) {
+  table = emoji_table_new(4);
+
+  char *keywords[] = {"grin", "face", NULL};
+  char *special[] = {"<tag>", "\"quoted\"", NULL};
+  char *none[] = {NULL};
+  add_emoji("😀", "Grinning face", keywords);
+  add_emoji("😀", "Grinning face", special);
+  add_emoji("😀", "Grinning face", none);
+  add_emoji("🦄", "Unicorn", none);
+}
+
+static void teardown(void) { emoji_table_free(table); }
+
+static void assert_format(unsigned int row, const char *format,
+                          const char *expected) {
+  char *formatted = format_emoji(table, row, format);
+  ck_assert_str_eq(formatted, expected);
+  g_free(formatted);
+}
+
+START_TEST(test_format_fields) {
+  assert_format(GRINNING, "{emoji} {name}", "😀 Grinning face");
+  assert_format(GRINNING, "{keywords}", "grin, face");
+  assert_format(GRINNING, "{codepoint}", "U+1F600");
+  assert_format(GRINNING, "{subgroup}/{unknown}/", "Face-smiling//");
+  assert_format(GRINNING, "{} { name } {", "{} { name } {");
+}
+END_TEST
+
+START_TEST(test_format_escaping) {
+  assert_format(GRINNING, "<b>{group}</b>", "<b>Smileys &amp; Emotion</b>");
+  assert_format(SPECIAL_KEYWORDS, "{keywords}",
+                "&lt;tag&gt;, &quot;quoted&quot;");
+}
+END_TEST
+
+START_TEST(test_format_sections) {
+  assert_format(GRINNING, "{emoji}[ ({keywords})]", "😀 (grin, face)");
+  assert_format(GRINNING, "[{unknown} ]{emoji}", "😀");
+  assert_format(NO_KEYWORDS, "{emoji}[ ({keywords})]", "😀");
+
+  // Like in Rofi, only the first field of a section is expanded.
+  assert_format(NO_KEYWORDS, "[{name}: {keywords}]",
+                "Grinning face: {keywords}");
+
+  // Sections end at the first closing bracket after the field, and cannot
+  // span lines.
+  assert_format(GRINNING, "[[a]{emoji}]]", "[a]😀]");
+  assert_format(GRINNING, "[a\n{emoji}]", "[a\n😀]");
+  assert_format(GRINNING, "[a{emoji}", "[a😀");
+}
+END_TEST
+
+START_TEST(test_format_compiled) {
+  EmojiFormat *format = emoji_format_new("{emoji} <b>{name}</b>[ {keywords}]");
+
+  // A compiled format can be rendered any number of times.
+  for (int i = 0; i < 2; ++i) {
+    char *formatted = emoji_format_render(format, table, GRINNING);
+    ck_assert_str_eq(formatted, "😀 <b>Grinning face</b> grin, face");
+    g_free(formatted);
+
+    formatted = emoji_format_render(format, table, UNICORN);
+    ck_assert_str_eq(formatted, "🦄 <b>Unicorn</b>");
+    g_free(formatted);
+  }
+
+  emoji_format_free(format);
+}
+END_TEST
+
+Suite *formatter_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Formatter");
+  tc_core = tcase_create("Core");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, test_format_fields);
+  tcase_add_test(tc_core, test_format_escaping);
+  tcase_add_test(tc_core, test_format_sections);
+  tcase_add_test(tc_core, test_format_compiled);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = formatter_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,78 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/keywords.h"
+
+START_TEST(test_add) {
+  KeywordDictionary *dictionary = keyword_dictionary_new();
+
+  char face[] = "Face";
+  guint32 id = keyword_dictionary_add(dictionary, face);
+  ck_assert_int_eq(id, 0);
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Hand"), 1);
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Face"), id);
+  ck_assert_int_eq(dictionary->keywords->len, 2);
+
+  // Added keywords are copied.
+  face[0] = 'R';
+  ck_assert_str_eq(keyword_dictionary_get(dictionary, id), "Face");
+
+  // Keywords are case-sensitive.
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "face"), 2);
+
+  keyword_dictionary_free(dictionary);
+}
+END_TEST
+
+START_TEST(test_append) {
+  KeywordDictionary *dictionary = keyword_dictionary_new();
+
+  // Appended keywords are found once other keywords are added.
+  ck_assert_int_eq(keyword_dictionary_append(dictionary, "Face"), 0);
+  ck_assert_int_eq(keyword_dictionary_append(dictionary, "Hand"), 1);
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Hand"), 1);
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Flag"), 2);
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Face"), 0);
+
+  // Enough keywords to grow the hash table a few times.
+  for (int i = 0; i < 1000; ++i) {
+    char *keyword = g_strdup_printf("Keyword %d", i);
+    ck_assert_int_eq(keyword_dictionary_add(dictionary, keyword), i + 3);
+    g_free(keyword);
+  }
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Keyword 500"), 503);
+  ck_assert_int_eq(keyword_dictionary_add(dictionary, "Hand"), 1);
+
+  keyword_dictionary_free(dictionary);
+}
+END_TEST
+
+Suite *keywords_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Keywords");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_add);
+  tcase_add_test(tc_core, test_append);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = keywords_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
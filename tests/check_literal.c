@@ -0,0 +1,143 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/literal.h"
+
+static char *strings[] = {
+    "😀 Grinning face Face, Grin",
+    "🦄 Unicorn Face, Unicorn",
+    "🐶 Dog face Dog, Pet",
+    "🌡 Thermometer Temperature",
+    "🐕 Dog Pet",
+};
+
+static Bitset *filter(const LiteralMatcher *matcher, const char *literal,
+                      gboolean caseless, gboolean invert) {
+  Bitset *rows = bitset_new(G_N_ELEMENTS(strings));
+  bitset_fill(rows);
+  literal_matcher_filter(matcher, literal, caseless, invert, rows, 0,
+                         rows->size);
+  return rows;
+}
+
+START_TEST(test_strings) {
+  LiteralMatcher *matcher =
+      literal_matcher_new(strings, G_N_ELEMENTS(strings));
+
+  for (unsigned int i = 0; i < G_N_ELEMENTS(strings); ++i) {
+    ck_assert_str_eq(literal_matcher_string(matcher, i), strings[i]);
+  }
+
+  literal_matcher_free(matcher);
+}
+END_TEST
+
+START_TEST(test_filter) {
+  LiteralMatcher *matcher =
+      literal_matcher_new(strings, G_N_ELEMENTS(strings));
+
+  Bitset *rows = filter(matcher, "FACE", TRUE, FALSE);
+  ck_assert_int_eq(bitset_count(rows), 3);
+  ck_assert(bitset_get(rows, 0));
+  ck_assert(bitset_get(rows, 1));
+  ck_assert(bitset_get(rows, 2));
+  bitset_free(rows);
+
+  rows = filter(matcher, "Face", FALSE, FALSE);
+  ck_assert_int_eq(bitset_count(rows), 2);
+  ck_assert(!bitset_get(rows, 2));
+  bitset_free(rows);
+
+  rows = filter(matcher, "dog", TRUE, TRUE);
+  ck_assert_int_eq(bitset_count(rows), 3);
+  ck_assert(!bitset_get(rows, 2));
+  ck_assert(!bitset_get(rows, 4));
+  bitset_free(rows);
+
+  // Matches never span two strings.
+  rows = filter(matcher, "PetGr", TRUE, FALSE);
+  ck_assert_int_eq(bitset_count(rows), 0);
+  bitset_free(rows);
+
+  // Non-ASCII literals are matched as-is.
+  rows = filter(matcher, "🦄", FALSE, FALSE);
+  ck_assert_int_eq(bitset_count(rows), 1);
+  ck_assert(bitset_get(rows, 1));
+  bitset_free(rows);
+
+  // Everything contains the empty string.
+  rows = filter(matcher, "", TRUE, FALSE);
+  ck_assert_int_eq(bitset_count(rows), 5);
+  bitset_free(rows);
+
+  // Rows that are not in the set are left alone.
+  rows = bitset_new(G_N_ELEMENTS(strings));
+  bitset_set(rows, 1);
+  bitset_set(rows, 3);
+  literal_matcher_filter(matcher, "e", TRUE, FALSE, rows, 0, rows->size);
+  ck_assert_int_eq(bitset_count(rows), 2);
+  bitset_free(rows);
+
+  // And so are rows outside of the range.
+  rows = bitset_new(G_N_ELEMENTS(strings));
+  bitset_fill(rows);
+  literal_matcher_filter(matcher, "dog", TRUE, FALSE, rows, 1, 3);
+  ck_assert_int_eq(bitset_count(rows), 4);
+  ck_assert(!bitset_get(rows, 1));
+  bitset_free(rows);
+
+  literal_matcher_free(matcher);
+}
+END_TEST
+
+START_TEST(test_supports) {
+  LiteralMatcher *matcher =
+      literal_matcher_new(strings, G_N_ELEMENTS(strings));
+
+  ck_assert(literal_matcher_supports(matcher, "face", TRUE));
+  ck_assert(literal_matcher_supports(matcher, "sky", TRUE));
+  ck_assert(literal_matcher_supports(matcher, "Ünicode", FALSE));
+  // Ignoring case for non-ASCII needs real case folding.
+  ck_assert(!literal_matcher_supports(matcher, "Ünicode", TRUE));
+  literal_matcher_free(matcher);
+
+  // Caseless "k" and "s" also match the Kelvin sign and the long s.
+  char *kelvin[] = {"300 \xe2\x84\xaa"};
+  matcher = literal_matcher_new(kelvin, 1);
+  ck_assert(!literal_matcher_supports(matcher, "sky", TRUE));
+  ck_assert(literal_matcher_supports(matcher, "sky", FALSE));
+  ck_assert(literal_matcher_supports(matcher, "300", TRUE));
+  literal_matcher_free(matcher);
+}
+END_TEST
+
+Suite *literal_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Literal");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_strings);
+  tcase_add_test(tc_core, test_filter);
+  tcase_add_test(tc_core, test_supports);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = literal_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,69 +1,204 @@
 #include <check.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "../src/loader.h"
 
-START_TEST(test_scan_until) {
-  const char *input = "this is an example";
+START_TEST(test_emoji_parse_line) {
+  EmojiTable *table = emoji_table_new(1);
+  ck_assert(parse_emoji_into_table(
+      table, "😀	 Smileys & Emotion 	face-smiling     "
+             "	grinning face 	face    | grin   \n"));
+
+  ck_assert_str_eq(emoji_table_bytes(table, 0), "😀");
+  ck_assert_str_eq(emoji_table_group(table, 0), "Smileys & Emotion");
+  ck_assert_str_eq(emoji_table_subgroup(table, 0), "Face-smiling");
+  ck_assert_str_eq(emoji_table_name(table, 0), "Grinning face");
+  ck_assert_int_eq(emoji_table_keyword_count(table, 0), 2);
+  ck_assert_str_eq(emoji_table_keyword(table, 0, 0), "Face");
+  ck_assert_str_eq(emoji_table_keyword(table, 0, 1), "Grin");
+
+  emoji_table_free(table);
+}
+END_TEST
+
+START_TEST(test_emoji_parse_skip_redundant_keywords) {
+  EmojiTable *table = emoji_table_new(1);
+  ck_assert(parse_emoji_into_table(
+      table, "😀	X	X	grinning face 	face|grinning face  |grin  \n"));
+
+  // The "grinning face" keyword is removed since its the same
+  // as the name.
+  ck_assert_int_eq(emoji_table_keyword_count(table, 0), 2);
+  ck_assert_str_eq(emoji_table_keyword(table, 0, 0), "Face");
+  ck_assert_str_eq(emoji_table_keyword(table, 0, 1), "Grin");
+
+  emoji_table_free(table);
+}
+END_TEST
 
-  const char *cursor = input;
-  char *result = NULL;
-  cursor = scan_until(' ', cursor, &result);
+START_TEST(test_emoji_parse_into_table) {
+  EmojiTable *table = emoji_table_new(1);
 
-  ck_assert_str_eq(result, "this");
-  ck_assert_str_eq(cursor, "is an example");
+  ck_assert(parse_emoji_into_table(
+      table,
+      "😀	Smileys & Emotion	face-smiling	grinning face	face | grin\n"));
+  ck_assert_int_eq(table->len, 1);
+  ck_assert_str_eq(emoji_table_bytes(table, 0), "😀");
+  ck_assert_str_eq(emoji_table_subgroup(table, 0), "Face-smiling");
+  ck_assert_str_eq(emoji_table_name(table, 0), "Grinning face");
+  ck_assert_int_eq(emoji_table_keyword_count(table, 0), 2);
+  ck_assert_str_eq(emoji_table_keyword(table, 0, 1), "Grin");
 
-  // Result is a copy!
-  result[0] = 'X';
-  ck_assert_str_eq(result, "Xhis");
-  ck_assert_str_eq(input, "this is an example");
-  g_free(result);
+  // Lines without keywords get an empty keyword list.
+  ck_assert(parse_emoji_into_table(table, "🦄	A	B	unicorn	\n"));
+  ck_assert_int_eq(emoji_table_keyword_count(table, 1), 0);
 
-  // Keep scanning!
-  cursor = scan_until('x', cursor, &result);
-  ck_assert_str_eq(result, "is an e");
-  ck_assert_str_eq(cursor, "ample");
-  g_free(result);
+  // Invalid lines are not added.
+  ck_assert(!parse_emoji_into_table(table, "🦄	A\n"));
+  ck_assert_int_eq(table->len, 2);
 
-  // Sets NULL result on no match without advancing cursor.
-  cursor = scan_until('Z', cursor, &result);
-  ck_assert_ptr_eq(result, NULL);
-  ck_assert_str_eq(cursor, "ample");
+  emoji_table_free(table);
 }
 END_TEST
 
-START_TEST(test_emoji_parse_line) {
-  const char *line = "😀	 Smileys & Emotion 	face-smiling     "
-                     "	grinning face 	face    | grin   \n";
-  Emoji *emoji = parse_emoji_from_line(line);
-
-  ck_assert_str_eq(emoji->bytes, "😀");
-  ck_assert_str_eq(emoji->group, "Smileys & Emotion");
-  ck_assert_str_eq(emoji->subgroup, "Face-smiling");
-  ck_assert_str_eq(emoji->name, "Grinning face");
-  ck_assert_int_eq(g_strv_length(emoji->keywords), 2);
-  ck_assert_str_eq(emoji->keywords[0], "Face");
-  ck_assert_str_eq(emoji->keywords[1], "Grin");
-  ck_assert_ptr_eq(emoji->keywords[2], NULL);
-
-  emoji_free(emoji);
+START_TEST(test_read_emojis_from_file) {
+  char *path;
+  int fd = g_file_open_tmp("rofi-emoji-XXXXXX.txt", &path, NULL);
+  close(fd);
+  g_file_set_contents(path,
+                      "😀	Smileys & Emotion	face-smiling	grinning face	"
+                      "grin | face\n"
+                      "🦄	Animals & Nature	animal-mammal	unicorn	face\n",
+                      -1, NULL);
+
+  EmojiTable *table = read_emojis_from_file(path, NULL);
+  ck_assert_int_eq(table->len, 2);
+  ck_assert_int_eq(table->groups->len, 2);
+  ck_assert_int_eq(table->group_ids[1], 1);
+  ck_assert_str_eq(emoji_table_name(table, 1), "Unicorn");
+  ck_assert_str_eq(emoji_table_keyword(table, 1, 0), "Face");
+
+  // Keywords are only stored once.
+  ck_assert_int_eq(table->keywords->keywords->len, 2);
+  ck_assert_int_eq(table->keyword_ids[table->keyword_offsets[0] + 1],
+                   table->keyword_ids[table->keyword_offsets[1]]);
+
+  emoji_table_free(table);
+  g_unlink(path);
+  g_free(path);
 }
 END_TEST
 
-START_TEST(test_emoji_parse_skip_redundant_keywords) {
-  const char *line =
-      "😀	X	X	grinning face 	face|grinning face  |grin  \n";
-  Emoji *emoji = parse_emoji_from_line(line);
-
-  // The "grinning face" keyword is removed since its the same
-  // as the name.
-  ck_assert_int_eq(g_strv_length(emoji->keywords), 2);
-  ck_assert_str_eq(emoji->keywords[0], "Face");
-  ck_assert_str_eq(emoji->keywords[1], "Grin");
-  ck_assert_ptr_eq(emoji->keywords[2], NULL);
+START_TEST(test_read_emojis_skipping_lines) {
+  GString *contents = g_string_new("");
+  g_string_append(contents, "😀	Smileys & Emotion	face-smiling	grinning face	"
+                            "grin\n");
+  g_string_append(contents, "🦄	Broken\n");
+  g_string_append(contents, "\n");
+  // Lines can be as long as they need to be.
+  g_string_append(contents, "🦄	Animals & Nature	animal-mammal	unicorn	face");
+  for (int i = 0; i < 1000; ++i) {
+    g_string_append_printf(contents, " | keyword %d", i);
+  }
+  g_string_append(contents, "\n");
+  g_string_append(contents, "Broken again\n");
+  // The last line does not need to end with a newline.
+  g_string_append(contents, "🐱	Animals & Nature	animal-mammal	cat	face");
+
+  char *path;
+  int fd = g_file_open_tmp("rofi-emoji-XXXXXX.txt", &path, NULL);
+  close(fd);
+  g_file_set_contents(path, contents->str, contents->len, NULL);
+
+  SkippedLines skipped;
+  EmojiTable *table = read_emojis_from_file(path, &skipped);
+  ck_assert_int_eq(table->len, 3);
+  ck_assert_str_eq(emoji_table_name(table, 1), "Unicorn");
+  ck_assert_int_eq(emoji_table_keyword_count(table, 1), 1001);
+  ck_assert_str_eq(emoji_table_keyword(table, 1, 1000), "Keyword 999");
+  ck_assert_str_eq(emoji_table_name(table, 2), "Cat");
+  ck_assert_str_eq(emoji_table_keyword(table, 2, 0), "Face");
+
+  // Empty lines are not reported.
+  ck_assert_int_eq(skipped.count, 2);
+  ck_assert_int_eq(skipped.lines[0], 2);
+  ck_assert_int_eq(skipped.lines[1], 5);
+
+  emoji_table_free(table);
+  g_string_free(contents, TRUE);
+  g_unlink(path);
+  g_free(path);
+}
+END_TEST
 
-  emoji_free(emoji);
+START_TEST(test_read_emojis_with_threads) {
+  GString *contents = g_string_new("");
+  for (int i = 0; i < 200; ++i) {
+    g_string_append_printf(contents, "😀	Group %d	sub-%d	emoji %d	k%d | x\n",
+                           (i * 7) % 5, (i * 3) % 11, i, i);
+    if (i % 25 == 0) {
+      g_string_append(contents, "🦄	Broken\n");
+    }
+  }
+
+  char *path;
+  int fd = g_file_open_tmp("rofi-emoji-XXXXXX.txt", &path, NULL);
+  close(fd);
+  g_file_set_contents(path, contents->str, contents->len, NULL);
+
+  SkippedLines expected_skipped;
+  EmojiTable *expected =
+      read_emojis_from_file_with_threads(path, 1, &expected_skipped);
+  ck_assert_int_eq(expected->len, 200);
+  ck_assert_int_eq(expected->groups->len, 5);
+  ck_assert_int_eq(expected->subgroups->len, 11);
+  ck_assert_int_eq(expected_skipped.count, 8);
+  for (int i = 0; i < MAX_REPORTED_LINES; ++i) {
+    ck_assert_int_eq(expected_skipped.lines[i], 2 + i * 26);
+  }
+
+  for (unsigned int threads = 2; threads <= 8; ++threads) {
+    SkippedLines skipped;
+    EmojiTable *table = read_emojis_from_file_with_threads(path, threads,
+                                                           &skipped);
+    ck_assert_int_eq(table->len, expected->len);
+    for (guint i = 0; i < expected->groups->len; ++i) {
+      ck_assert_str_eq(g_ptr_array_index(table->groups, i),
+                       g_ptr_array_index(expected->groups, i));
+    }
+    for (guint i = 0; i < expected->subgroups->len; ++i) {
+      ck_assert_str_eq(g_ptr_array_index(table->subgroups, i),
+                       g_ptr_array_index(expected->subgroups, i));
+    }
+    for (unsigned int i = 0; i < expected->len; ++i) {
+      ck_assert_str_eq(emoji_table_name(table, i),
+                       emoji_table_name(expected, i));
+      ck_assert_str_eq(emoji_table_group(table, i),
+                       emoji_table_group(expected, i));
+      ck_assert_int_eq(table->group_ids[i], expected->group_ids[i]);
+      ck_assert_int_eq(table->subgroup_ids[i], expected->subgroup_ids[i]);
+      ck_assert_int_eq(table->keyword_offsets[i + 1],
+                       expected->keyword_offsets[i + 1]);
+      ck_assert_int_eq(table->keyword_ids[table->keyword_offsets[i]],
+                       expected->keyword_ids[expected->keyword_offsets[i]]);
+      ck_assert_str_eq(emoji_table_keyword(table, i, 0),
+                       emoji_table_keyword(expected, i, 0));
+    }
+
+    ck_assert_int_eq(skipped.count, expected_skipped.count);
+    for (int i = 0; i < MAX_REPORTED_LINES; ++i) {
+      ck_assert_int_eq(skipped.lines[i], expected_skipped.lines[i]);
+    }
+    emoji_table_free(table);
+  }
+
+  emoji_table_free(expected);
+  g_string_free(contents, TRUE);
+  g_unlink(path);
+  g_free(path);
 }
 END_TEST
 
@@ -74,9 +209,12 @@ Suite *loader_suite(void) {
   s = suite_create("Loader");
   tc_core = tcase_create("Core");
 
-  tcase_add_test(tc_core, test_scan_until);
   tcase_add_test(tc_core, test_emoji_parse_line);
   tcase_add_test(tc_core, test_emoji_parse_skip_redundant_keywords);
+  tcase_add_test(tc_core, test_emoji_parse_into_table);
+  tcase_add_test(tc_core, test_read_emojis_from_file);
+  tcase_add_test(tc_core, test_read_emojis_skipping_lines);
+  tcase_add_test(tc_core, test_read_emojis_with_threads);
   suite_add_tcase(s, tc_core);
 
   return s;
@@ -0,0 +1,156 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/matcher.h"
+
+// Builds a token the way Rofi's default matching method does.
+static rofi_int_matcher *new_matcher(const char *text, gboolean caseless) {
+  rofi_int_matcher *matcher = g_new0(rofi_int_matcher, 1);
+  char *pattern = g_regex_escape_string(text, -1);
+  matcher->regex = g_regex_new(
+      pattern, G_REGEX_OPTIMIZE | (caseless ? G_REGEX_CASELESS : 0), 0, NULL);
+  g_free(pattern);
+  return matcher;
+}
+
+static void free_matcher(rofi_int_matcher *matcher) {
+  g_regex_unref(matcher->regex);
+  g_free(matcher);
+}
+
+START_TEST(test_literal) {
+  rofi_int_matcher *matcher = new_matcher("face", TRUE);
+  char *literal = matcher_literal(matcher);
+  ck_assert_str_eq(literal, "face");
+  ck_assert(matcher_is_caseless(matcher));
+  g_free(literal);
+  free_matcher(matcher);
+
+  matcher = new_matcher("a.b*[c]\\", FALSE);
+  literal = matcher_literal(matcher);
+  ck_assert_str_eq(literal, "a.b*[c]\\");
+  ck_assert(!matcher_is_caseless(matcher));
+  g_free(literal);
+  free_matcher(matcher);
+
+  // Anything other than an escaped string is not a literal.
+  matcher = g_new0(rofi_int_matcher, 1);
+  matcher->regex = g_regex_new("f.ce", 0, 0, NULL);
+  ck_assert_ptr_eq(matcher_literal(matcher), NULL);
+  free_matcher(matcher);
+
+  matcher = g_new0(rofi_int_matcher, 1);
+  matcher->regex = g_regex_new("\\bface", 0, 0, NULL);
+  ck_assert_ptr_eq(matcher_literal(matcher), NULL);
+  free_matcher(matcher);
+}
+END_TEST
+
+START_TEST(test_equal) {
+  rofi_int_matcher *a[] = {new_matcher("dog", TRUE), new_matcher("pet", TRUE),
+                           NULL};
+  rofi_int_matcher *b[] = {new_matcher("dog", TRUE), new_matcher("pet", TRUE),
+                           NULL};
+  rofi_int_matcher *case_sensitive[] = {new_matcher("dog", FALSE),
+                                        new_matcher("pet", FALSE), NULL};
+  rofi_int_matcher *shorter[] = {new_matcher("dog", TRUE), NULL};
+
+  ck_assert(matchers_equal(a, b));
+  ck_assert(matchers_equal(NULL, NULL));
+  ck_assert(!matchers_equal(a, NULL));
+  ck_assert(!matchers_equal(a, case_sensitive));
+  ck_assert(!matchers_equal(a, shorter));
+  ck_assert(!matchers_equal(shorter, a));
+
+  GString *key_a = g_string_new("");
+  GString *key_b = g_string_new("");
+  matchers_append_key(key_a, a);
+  matchers_append_key(key_b, b);
+  ck_assert_str_eq(key_a->str, key_b->str);
+
+  b[1]->invert = TRUE;
+  ck_assert(!matchers_equal(a, b));
+
+  g_string_truncate(key_b, 0);
+  matchers_append_key(key_b, b);
+  ck_assert_str_ne(key_a->str, key_b->str);
+
+  g_string_free(key_a, TRUE);
+  g_string_free(key_b, TRUE);
+
+  for (int i = 0; i < 2; ++i) {
+    free_matcher(a[i]);
+    free_matcher(b[i]);
+    free_matcher(case_sensitive[i]);
+  }
+  free_matcher(shorter[0]);
+}
+END_TEST
+
+START_TEST(test_narrow) {
+  rofi_int_matcher *gri[] = {new_matcher("gri", TRUE), NULL};
+  rofi_int_matcher *grin[] = {new_matcher("grin", TRUE), NULL};
+  rofi_int_matcher *grin_face[] = {new_matcher("grin", TRUE),
+                                   new_matcher("face", TRUE), NULL};
+  rofi_int_matcher *grin_sensitive[] = {new_matcher("grin", FALSE), NULL};
+  rofi_int_matcher *not_gri[] = {new_matcher("gri", TRUE), NULL};
+  rofi_int_matcher *not_grin[] = {new_matcher("grin", TRUE), NULL};
+  not_gri[0]->invert = TRUE;
+  not_grin[0]->invert = TRUE;
+
+  ck_assert(matchers_narrow(grin, gri));
+  ck_assert(matchers_narrow(grin_face, gri));
+  ck_assert(matchers_narrow(grin_face, grin));
+  ck_assert(matchers_narrow(gri, NULL));
+  ck_assert(!matchers_narrow(NULL, gri));
+  ck_assert(!matchers_narrow(gri, grin));
+  ck_assert(!matchers_narrow(grin, grin_face));
+
+  // Case sensitive matches are a subset of caseless ones.
+  ck_assert(matchers_narrow(grin_sensitive, gri));
+  ck_assert(!matchers_narrow(grin, grin_sensitive));
+
+  // Extending an excluded word lets more strings through.
+  ck_assert(matchers_narrow(not_gri, not_gri));
+  ck_assert(!matchers_narrow(not_grin, not_gri));
+
+  free_matcher(gri[0]);
+  free_matcher(grin[0]);
+  free_matcher(grin_face[0]);
+  free_matcher(grin_face[1]);
+  free_matcher(grin_sensitive[0]);
+  free_matcher(not_gri[0]);
+  free_matcher(not_grin[0]);
+}
+END_TEST
+
+Suite *matcher_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Matcher");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_literal);
+  tcase_add_test(tc_core, test_equal);
+  tcase_add_test(tc_core, test_narrow);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = matcher_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,193 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+// mallinfo2() is only there since glibc 2.33.
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+#include <malloc.h>
+#define HAVE_MALLINFO2 1
+#endif
+#endif
+
+#include "../bench/dataset.h"
+#include "../src/formatter.h"
+#include "../src/literal.h"
+#include "../src/loader.h"
+#include "../src/trigram.h"
+
+// Checks that loading and searching large emoji files scales linearly or
+// better, by comparing made-up files of different sizes. Memory is always
+// compared, but timings depend too much on the machine to fail `make check` on
+// a busy one, so they are only compared when ROFI_EMOJI_SCALING_TIMING is set.
+// Even then, ten times the emojis may take up to SLACK times longer than ten
+// times as long before failing.
+//
+// The comparison of 100k to 1M emojis takes a while and is only run when
+// ROFI_EMOJI_SCALING_1M is set.
+#define SLACK 3.0
+
+static const char *QUERIES[] = {"go", "ta", "ki", "lomi", "resowa",
+                                "Face", "zzz", "ba be", "\xf0\x9f\x8c"};
+
+typedef struct {
+  unsigned int count;
+  double load_us;
+  double bytes_per_emoji;
+  double match_us;
+} Sample;
+
+static gsize allocated_bytes(void) {
+#ifdef HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+// Searches the table like the plugin does for a plain query, without Rofi.
+static double match_queries(EmojiTable *table) {
+  EmojiFormat *format = emoji_format_new("{emoji} {name} {keywords}");
+  char **strings = g_new(char *, table->len + 1);
+  for (unsigned int i = 0; i < table->len; ++i) {
+    strings[i] = emoji_format_render(format, table, i);
+  }
+  strings[table->len] = NULL;
+  emoji_format_free(format);
+
+  TrigramIndex *index = trigram_index_new(strings, table->len);
+  LiteralMatcher *matcher = literal_matcher_new(strings, table->len);
+  g_strfreev(strings);
+
+  gint64 start = g_get_monotonic_time();
+  for (unsigned int i = 0; i < G_N_ELEMENTS(QUERIES); ++i) {
+    Bitset *rows = trigram_index_lookup(index, QUERIES[i], TRUE);
+    if (rows == NULL) {
+      rows = bitset_new(table->len);
+      bitset_fill(rows);
+    }
+    literal_matcher_filter(matcher, QUERIES[i], TRUE, FALSE, rows, 0,
+                           rows->size);
+    bitset_free(rows);
+  }
+  double elapsed = g_get_monotonic_time() - start;
+
+  trigram_index_free(index);
+  literal_matcher_free(matcher);
+  return elapsed;
+}
+
+// Takes the fastest of a few runs, which is the least disturbed by whatever
+// else runs on the machine.
+static Sample measure(unsigned int count) {
+  Sample sample = {.count = count, .load_us = G_MAXDOUBLE,
+                   .match_us = G_MAXDOUBLE};
+
+  char *path = write_synthetic_emoji_file(count, 1);
+  ck_assert_ptr_nonnull(path);
+
+  for (int run = 0; run < 3; ++run) {
+    gsize allocated = allocated_bytes();
+    gint64 start = g_get_monotonic_time();
+    EmojiTable *table = read_emojis_from_file(path, NULL);
+    sample.load_us = MIN(sample.load_us, g_get_monotonic_time() - start);
+
+    ck_assert_ptr_nonnull(table);
+    ck_assert_uint_eq(table->len, count);
+    sample.bytes_per_emoji =
+        (double)(allocated_bytes() - allocated) / table->len;
+
+    sample.match_us = MIN(sample.match_us, match_queries(table));
+    emoji_table_free(table);
+  }
+
+  g_unlink(path);
+  g_free(path);
+  return sample;
+}
+
+static void assert_scales(Sample small, Sample large) {
+  ck_assert_msg(large.bytes_per_emoji <= small.bytes_per_emoji * 1.5,
+                "%u emojis took %.0f bytes each, %u took %.0f bytes each",
+                small.count, small.bytes_per_emoji, large.count,
+                large.bytes_per_emoji);
+
+  if (g_getenv("ROFI_EMOJI_SCALING_TIMING") == NULL) {
+    return;
+  }
+
+  double factor = (double)large.count / small.count;
+  ck_assert_msg(large.load_us <= small.load_us * factor * SLACK,
+                "Loading %u emojis took %.0f us, %u took %.0f us", small.count,
+                small.load_us, large.count, large.load_us);
+  ck_assert_msg(large.match_us <= small.match_us * factor * SLACK,
+                "Searching %u emojis took %.0f us, %u took %.0f us",
+                small.count, small.match_us, large.count, large.match_us);
+}
+
+START_TEST(test_100k) { assert_scales(measure(10000), measure(100000)); }
+END_TEST
+
+START_TEST(test_1m) {
+  if (g_getenv("ROFI_EMOJI_SCALING_1M") == NULL) {
+    return;
+  }
+  assert_scales(measure(100000), measure(1000000));
+}
+END_TEST
+
+START_TEST(test_generator) {
+  // The same seed gives the same emojis, and every line is loaded.
+  char *first = write_synthetic_emoji_file(1000, 7);
+  char *second = write_synthetic_emoji_file(1000, 7);
+  char *first_contents;
+  char *second_contents;
+  ck_assert(g_file_get_contents(first, &first_contents, NULL, NULL));
+  ck_assert(g_file_get_contents(second, &second_contents, NULL, NULL));
+  ck_assert_str_eq(first_contents, second_contents);
+
+  EmojiTable *table = read_emojis_from_file(first, NULL);
+  ck_assert_uint_eq(table->len, 1000);
+  emoji_table_free(table);
+
+  g_unlink(first);
+  g_unlink(second);
+  g_free(first_contents);
+  g_free(second_contents);
+  g_free(first);
+  g_free(second);
+}
+END_TEST
+
+Suite *scaling_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Scaling");
+  tc_core = tcase_create("Core");
+  // Generating and loading a million emojis takes a while.
+  tcase_set_timeout(tc_core, 600);
+
+  tcase_add_test(tc_core, test_generator);
+  tcase_add_test(tc_core, test_100k);
+  tcase_add_test(tc_core, test_1m);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = scaling_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
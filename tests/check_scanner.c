@@ -0,0 +1,98 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/scanner.h"
+
+// Returns the offsets of all delimiters the scanner finds, separated by
+// spaces.
+static char *scan(const char *text, gsize length) {
+  GString *offsets = g_string_new("");
+  FieldScanner scanner;
+  field_scanner_init(&scanner, text, length);
+
+  const char *delimiter;
+  while ((delimiter = field_scanner_next(&scanner)) != NULL) {
+    g_string_append_printf(offsets, "%s%ld", offsets->len > 0 ? " " : "",
+                           (long)(delimiter - text));
+  }
+  return g_string_free(offsets, FALSE);
+}
+
+START_TEST(test_scan_line) {
+  const char *line = "😀\tSmileys & Emotion\tface-smiling\tgrinning face\t"
+                     "face | grin\n";
+  char *offsets = scan(line, strlen(line));
+  ck_assert_str_eq(offsets, "4 22 35 49 55 61");
+  g_free(offsets);
+
+  // NUL bytes are delimiters too, so that they can be rejected.
+  offsets = scan("a\0b|c", 5);
+  ck_assert_str_eq(offsets, "1 3");
+  g_free(offsets);
+
+  offsets = scan("", 0);
+  ck_assert_str_eq(offsets, "");
+  g_free(offsets);
+}
+END_TEST
+
+START_TEST(test_scan_blocks) {
+  // Delimiters at every position in and around blocks of 16 bytes, and
+  // nothing past the end of the text.
+  char text[80];
+  for (gsize length = 0; length < 64; ++length) {
+    for (gsize position = 0; position < length; ++position) {
+      memset(text, 'x', sizeof(text));
+      text[position] = '|';
+      text[length] = '\t';
+
+      char *offsets = scan(text, length);
+      char *expected = g_strdup_printf("%ld", (long)position);
+      ck_assert_str_eq(offsets, expected);
+      g_free(expected);
+      g_free(offsets);
+    }
+  }
+
+  memset(text, '\n', sizeof(text));
+  char *offsets = scan(text, 40);
+  GString *expected = g_string_new("0");
+  for (int i = 1; i < 40; ++i) {
+    g_string_append_printf(expected, " %d", i);
+  }
+  ck_assert_str_eq(offsets, expected->str);
+  g_string_free(expected, TRUE);
+  g_free(offsets);
+}
+END_TEST
+
+Suite *scanner_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Scanner");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_scan_line);
+  tcase_add_test(tc_core, test_scan_blocks);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = scanner_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
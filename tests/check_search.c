@@ -0,0 +1,135 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rofi/helper.h>
+
+#include "../bench/rofi-shim.h"
+#include "../src/matcher.h"
+#include "../src/search.h"
+
+static EmojiModePrivateData pd;
+
+static void add_emoji(EmojiTable *table, const char *bytes, const char *name,
+                      const char *group) {
+  guint32 keyword = keyword_dictionary_add(table->keywords, "Face");
+  emoji_table_add(table, bytes, name, emoji_table_add_group(table, group),
+                  emoji_table_add_subgroup(table, "face"), &keyword, 1);
+}
+
+static void setup(void) {
+  memset(&pd, 0, sizeof(pd));
+  pd.emojis = emoji_table_new(3);
+  add_emoji(pd.emojis, "😀", "Grinning face", "Smileys & Emotion");
+  add_emoji(pd.emojis, "🐶", "Dog face", "Animals & Nature");
+  add_emoji(pd.emojis, "😺", "Grinning cat", "Smileys & Emotion");
+  pd.selected_emoji = NO_EMOJI;
+  pd.search_threads = 1;
+  emoji_search_init(&pd);
+}
+
+static void teardown(void) {
+  emoji_search_destroy(&pd);
+  emoji_table_free(pd.emojis);
+}
+
+// Searches for `input` like Rofi does when it is started with `argv`, and
+// returns the rows it lists, separated by spaces.
+static char *search(char **argv, const char *input) {
+  rofi_shim_set_arguments(g_strv_length(argv), argv);
+
+  // With -case-smart, Rofi decides on case sensitivity by the input as it was
+  // typed, before the plugin takes the group and subgroup filters out of it.
+  int case_sensitive = find_arg("-case-sensitive") >= 0;
+  if (find_arg("-case-smart") >= 0) {
+    case_sensitive = FALSE;
+    for (const char *c = input; *c != '\0'; ++c) {
+      case_sensitive |= g_ascii_isupper(*c);
+    }
+  }
+
+  char *query = emoji_search_preprocess_input(&pd, input);
+  rofi_int_matcher **tokens = helper_tokenize(query, case_sensitive);
+
+  // The plugin answers from its own tokens when they are the same as Rofi's.
+  ck_assert(matchers_equal(tokens, pd.search_tokens));
+
+  GString *rows = g_string_new("");
+  for (unsigned int line = 0; line < pd.emojis->len; ++line) {
+    if (emoji_search_token_match(&pd, tokens, line)) {
+      g_string_append_printf(rows, "%s%u", rows->len > 0 ? " " : "", line);
+    }
+  }
+
+  helper_tokenize_free(tokens);
+  g_free(query);
+  return g_string_free(rows, FALSE);
+}
+
+static void assert_search(char **argv, const char *input,
+                          const char *expected) {
+  char *rows = search(argv, input);
+  ck_assert_str_eq(rows, expected);
+  g_free(rows);
+}
+
+START_TEST(test_search) {
+  char *argv[] = {"rofi", NULL};
+  assert_search(argv, "face", "0 1 2");
+  assert_search(argv, "grinning", "0 2");
+  assert_search(argv, "@smileys grinning", "0 2");
+  assert_search(argv, "@animals -dog", "");
+}
+END_TEST
+
+START_TEST(test_case_sensitive) {
+  char *argv[] = {"rofi", "-case-sensitive", NULL};
+  assert_search(argv, "grinning", "");
+  assert_search(argv, "Grinning", "0 2");
+}
+END_TEST
+
+START_TEST(test_case_smart) {
+  char *argv[] = {"rofi", "-case-smart", NULL};
+  assert_search(argv, "grinning", "0 2");
+  assert_search(argv, "Grinning face", "0");
+
+  // An uppercase group filter makes the whole query case-sensitive, even
+  // though only lowercase is left of it.
+  assert_search(argv, "@Smileys grinning", "");
+  assert_search(argv, "@Smileys Grinning", "0 2");
+  assert_search(argv, "@smileys grinning", "0 2");
+}
+END_TEST
+
+Suite *search_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Search");
+  tc_core = tcase_create("Core");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, test_search);
+  tcase_add_test(tc_core, test_case_sensitive);
+  tcase_add_test(tc_core, test_case_smart);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = search_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,282 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include "../src/snapshot.h"
+
+static char *tmp_dir = NULL;
+static char *source_path = NULL;
+static char *snapshot_path = NULL;
+
+static const char *contents =
+    "😀\tSmileys & Emotion\tface-smiling\tgrinning face\tface | grin\n"
+    "🦄\tAnimals & Nature\tanimal-mammal\tunicorn\tface | unicorn\n"
+    "not an emoji\n"
+    "🐶\tAnimals & Nature\tanimal-mammal\tdog face\tdog | pet\n";
+
+static void setup(void) {
+  tmp_dir = g_dir_make_tmp("rofi-emoji-XXXXXX", NULL);
+  source_path = g_build_filename(tmp_dir, "emojis.txt", NULL);
+  snapshot_path = g_build_filename(tmp_dir, "emojis.snapshot", NULL);
+  g_file_set_contents(source_path, contents, -1, NULL);
+}
+
+static void teardown(void) {
+  g_unlink(snapshot_path);
+  g_unlink(source_path);
+  g_rmdir(tmp_dir);
+  g_free(snapshot_path);
+  g_free(source_path);
+  g_free(tmp_dir);
+}
+
+// Builds everything a snapshot holds out of the emoji file, matching on the
+// names of the emojis.
+static void build(Snapshot *snapshot) {
+  snapshot->emojis = read_emojis_from_file(source_path, &snapshot->skipped);
+  ck_assert_ptr_ne(snapshot->emojis, NULL);
+
+  unsigned int count = snapshot->emojis->len;
+  char **strings = g_new0(char *, count + 1);
+  for (unsigned int row = 0; row < count; ++row) {
+    strings[row] = g_strdup(emoji_table_name(snapshot->emojis, row));
+  }
+  snapshot->strings = literal_matcher_new(strings, count);
+  snapshot->index = trigram_index_new(strings, count);
+  g_strfreev(strings);
+}
+
+static void free_snapshot(Snapshot *snapshot) {
+  emoji_table_free(snapshot->emojis);
+  literal_matcher_free(snapshot->strings);
+  trigram_index_free(snapshot->index);
+}
+
+static void write_snapshot(void) {
+  SnapshotSource source;
+  ck_assert(snapshot_source_identify(source_path, &source));
+
+  Snapshot snapshot;
+  build(&snapshot);
+  char *error = NULL;
+  ck_assert_int_eq(write_emoji_snapshot(&snapshot, source_path, &source,
+                                        snapshot_path, &error),
+                   TRUE);
+  free_snapshot(&snapshot);
+}
+
+static gboolean read_snapshot(Snapshot *snapshot) {
+  SnapshotSource source;
+  ck_assert(snapshot_source_identify(source_path, &source));
+  return read_emoji_snapshot(snapshot_path, source_path, &source, snapshot);
+}
+
+START_TEST(test_snapshot_path) {
+  char *path = emoji_snapshot_path("/usr/share/rofi-emoji/all_emojis.txt");
+  char *directory = g_build_filename(g_get_user_cache_dir(), "rofi-emoji",
+                                     NULL);
+  ck_assert(g_str_has_prefix(path, directory));
+  ck_assert(g_str_has_suffix(path, ".snapshot"));
+
+  // Relative paths are named after the file they point to.
+  char *current_dir = g_get_current_dir();
+  char *absolute = g_build_filename(current_dir, "emojis.txt", NULL);
+  char *relative_path = emoji_snapshot_path("emojis.txt");
+  char *absolute_path = emoji_snapshot_path(absolute);
+  ck_assert_str_eq(relative_path, absolute_path);
+  ck_assert_str_ne(relative_path, path);
+
+  g_free(absolute_path);
+  g_free(relative_path);
+  g_free(absolute);
+  g_free(current_dir);
+  g_free(directory);
+  g_free(path);
+}
+END_TEST
+
+START_TEST(test_round_trip) {
+  write_snapshot();
+
+  Snapshot snapshot;
+  ck_assert(read_snapshot(&snapshot));
+
+  EmojiTable *emojis = snapshot.emojis;
+  ck_assert_int_eq(emojis->len, 3);
+  ck_assert_str_eq(emoji_table_bytes(emojis, 1), "🦄");
+  ck_assert_str_eq(emoji_table_name(emojis, 1), "Unicorn");
+  ck_assert_str_eq(emoji_table_subgroup(emojis, 2), "Animal-mammal");
+  ck_assert_str_eq(emoji_table_keyword(emojis, 2, 1), "Pet");
+
+  // Everything is used straight from the mapping.
+  gsize length;
+  const char *data = g_bytes_get_data(emojis->database, &length);
+  const char *string = literal_matcher_string(snapshot.strings, 2);
+  ck_assert_str_eq(string, "Dog face");
+  ck_assert(string > data && string < data + length);
+
+  Bitset *rows = bitset_new(emojis->len);
+  bitset_fill(rows);
+  literal_matcher_filter(snapshot.strings, "FACE", TRUE, FALSE, rows, 0,
+                         emojis->len);
+  ck_assert_int_eq(bitset_count(rows), 2);
+  ck_assert(!bitset_get(rows, 1));
+  bitset_free(rows);
+
+  rows = trigram_index_lookup(snapshot.index, "UNICORN", TRUE);
+  ck_assert_int_eq(bitset_count(rows), 1);
+  ck_assert(bitset_get(rows, 1));
+  bitset_free(rows);
+
+  // Lines that were skipped are still reported.
+  ck_assert_int_eq(snapshot.skipped.count, 1);
+  ck_assert_int_eq(snapshot.skipped.lines[0], 3);
+
+  free_snapshot(&snapshot);
+}
+END_TEST
+
+START_TEST(test_map) {
+  SnapshotSource source;
+  ck_assert(snapshot_source_identify(source_path, &source));
+  Snapshot built;
+  build(&built);
+
+  // Snapshots can be kept anywhere in memory, as long as they are aligned.
+  GString *out = g_string_new("");
+  g_string_append_len(out, "prefix\0\0", 8);
+  emoji_snapshot_append(&built, "emojis.txt", &source, out);
+  free_snapshot(&built);
+
+  guint64 *data = g_new(guint64, out->len / sizeof(guint64) + 1);
+  memcpy(data, out->str, out->len);
+  GBytes *bytes = g_bytes_new_with_free_func(data + 1, out->len - 8, g_free,
+                                             data);
+
+  Snapshot snapshot;
+  ck_assert(emoji_snapshot_map(bytes, &snapshot));
+  g_bytes_unref(bytes);
+  ck_assert_int_eq(snapshot.emojis->len, 3);
+  ck_assert_str_eq(emoji_table_name(snapshot.emojis, 0), "Grinning face");
+  ck_assert_str_eq(literal_matcher_string(snapshot.strings, 1), "Unicorn");
+  free_snapshot(&snapshot);
+
+  g_string_free(out, TRUE);
+}
+END_TEST
+
+START_TEST(test_missing_snapshot) {
+  Snapshot snapshot;
+  ck_assert(!read_snapshot(&snapshot));
+}
+END_TEST
+
+START_TEST(test_stale_snapshot) {
+  write_snapshot();
+
+  struct stat info;
+  ck_assert_int_eq(g_stat(source_path, &info), 0);
+
+  // Changed contents are noticed even when the size and modification time
+  // stay the same.
+  char *changed = g_strdup(contents);
+  changed[strlen(changed) - 2] = 'x';
+  g_file_set_contents(source_path, changed, -1, NULL);
+  struct utimbuf times = {info.st_atime, info.st_mtime};
+  ck_assert_int_eq(g_utime(source_path, &times), 0);
+
+  Snapshot snapshot;
+  ck_assert(!read_snapshot(&snapshot));
+
+  // Back to the contents the snapshot was built from.
+  g_file_set_contents(source_path, contents, -1, NULL);
+  ck_assert_int_eq(g_utime(source_path, &times), 0);
+  ck_assert(read_snapshot(&snapshot));
+  free_snapshot(&snapshot);
+
+  g_free(changed);
+}
+END_TEST
+
+START_TEST(test_other_source) {
+  write_snapshot();
+
+  // A snapshot of an identical file elsewhere is not used.
+  char *other_path = g_build_filename(tmp_dir, "other.txt", NULL);
+  g_file_set_contents(other_path, contents, -1, NULL);
+
+  SnapshotSource source;
+  ck_assert(snapshot_source_identify(source_path, &source));
+  Snapshot snapshot;
+  ck_assert(!read_emoji_snapshot(snapshot_path, other_path, &source,
+                                 &snapshot));
+
+  g_unlink(other_path);
+  g_free(other_path);
+}
+END_TEST
+
+START_TEST(test_corrupt_snapshot) {
+  write_snapshot();
+
+  char *data;
+  gsize length;
+  g_file_get_contents(snapshot_path, &data, &length, NULL);
+
+  // Truncated in the middle of the trigram index.
+  g_file_set_contents(snapshot_path, data, length - 4, NULL);
+  Snapshot snapshot;
+  ck_assert(!read_snapshot(&snapshot));
+
+  // A row out of range at the very end of the trigram index.
+  data[length - 4] = (char)0xff;
+  g_file_set_contents(snapshot_path, data, length, NULL);
+  ck_assert(!read_snapshot(&snapshot));
+
+  // Garbage instead of a header.
+  g_file_set_contents(snapshot_path, "not a snapshot", -1, NULL);
+  ck_assert(!read_snapshot(&snapshot));
+
+  g_free(data);
+}
+END_TEST
+
+Suite *snapshot_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Snapshot");
+  tc_core = tcase_create("Core");
+
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, test_snapshot_path);
+  tcase_add_test(tc_core, test_round_trip);
+  tcase_add_test(tc_core, test_map);
+  tcase_add_test(tc_core, test_missing_snapshot);
+  tcase_add_test(tc_core, test_stale_snapshot);
+  tcase_add_test(tc_core, test_other_source);
+  tcase_add_test(tc_core, test_corrupt_snapshot);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = snapshot_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
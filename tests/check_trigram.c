@@ -0,0 +1,89 @@
+#include <check.h>
+#include <glib.h>
+#include <stdlib.h>
+
+#include "../src/trigram.h"
+
+static char *strings[] = {
+    "😀 Grinning face Face, Grin",
+    "🦄 Unicorn Face, Unicorn",
+    "🐶 Dog face Dog, Pet",
+    "🌡 Thermometer 300 \xe2\x84\xaa",
+};
+
+START_TEST(test_lookup) {
+  TrigramIndex *index = trigram_index_new(strings, G_N_ELEMENTS(strings));
+
+  Bitset *rows = trigram_index_lookup(index, "FACE", TRUE);
+  ck_assert_ptr_ne(rows, NULL);
+  ck_assert_int_eq(bitset_count(rows), 3);
+  ck_assert(!bitset_get(rows, 3));
+  bitset_free(rows);
+
+  rows = trigram_index_lookup(index, "dog face", TRUE);
+  ck_assert_int_eq(bitset_count(rows), 1);
+  ck_assert(bitset_get(rows, 2));
+  bitset_free(rows);
+
+  // Trigrams that are not in the index rule out every row.
+  rows = trigram_index_lookup(index, "xyz", TRUE);
+  ck_assert_int_eq(bitset_count(rows), 0);
+  bitset_free(rows);
+
+  // The index can only narrow down literals of at least three bytes.
+  ck_assert_ptr_eq(trigram_index_lookup(index, "do", TRUE), NULL);
+
+  trigram_index_free(index);
+}
+END_TEST
+
+START_TEST(test_lookup_case_exceptions) {
+  TrigramIndex *index = trigram_index_new(strings, G_N_ELEMENTS(strings));
+
+  // "k" matches the Kelvin sign when ignoring case, so trigrams with a "k" can
+  // no longer rule anything out.
+  ck_assert_ptr_eq(trigram_index_lookup(index, "00k", TRUE), NULL);
+
+  Bitset *rows = trigram_index_lookup(index, "00k", FALSE);
+  ck_assert_int_eq(bitset_count(rows), 0);
+  bitset_free(rows);
+
+  // Non-ASCII trigrams are only used when matching case.
+  ck_assert_ptr_eq(trigram_index_lookup(index, "🦄", TRUE), NULL);
+  rows = trigram_index_lookup(index, "🦄", FALSE);
+  ck_assert_int_eq(bitset_count(rows), 1);
+  ck_assert(bitset_get(rows, 1));
+  bitset_free(rows);
+
+  trigram_index_free(index);
+}
+END_TEST
+
+Suite *trigram_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Trigram");
+  tc_core = tcase_create("Core");
+
+  tcase_add_test(tc_core, test_lookup);
+  tcase_add_test(tc_core, test_lookup_case_exceptions);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = trigram_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,221 @@
+#include <check.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/usage.h"
+
+#define DAY (24 * 60 * 60)
+#define NOW ((gint64)1700000000)
+
+static char *tmp_dir = NULL;
+static char *log_path = NULL;
+// The emoji file the emojis are used from, NULL for the bundled emojis.
+static const char *emoji_file = NULL;
+
+static EmojiTable *build_table(const char **emojis) {
+  EmojiTable *table = emoji_table_new(4);
+  for (const char **emoji = emojis; *emoji != NULL; ++emoji) {
+    emoji_table_add(table, *emoji, *emoji, 0, 0, NULL, 0);
+  }
+  return table;
+}
+
+static EmojiTable *emojis = NULL;
+
+static void setup(void) {
+  tmp_dir = g_dir_make_tmp("rofi-emoji-XXXXXX", NULL);
+  // In a directory that does not exist yet.
+  log_path = g_build_filename(tmp_dir, "rofi-emoji", "usage", NULL);
+  emoji_file = NULL;
+  emojis = build_table((const char *[]){"😀", "🦄", "🐶", "🐱", NULL});
+}
+
+static void teardown(void) {
+  char *log_dir = g_path_get_dirname(log_path);
+  g_unlink(log_path);
+  g_rmdir(log_dir);
+  g_rmdir(tmp_dir);
+  g_free(log_dir);
+  g_free(log_path);
+  g_free(tmp_dir);
+  emoji_table_free(emojis);
+}
+
+static void use(const EmojiTable *table, unsigned int row, gint64 time) {
+  char *error = NULL;
+  ck_assert(usage_log_append(log_path, emoji_file, table, row, time, &error));
+  ck_assert_ptr_eq(error, NULL);
+}
+
+// Returns the rows in the order they are listed, separated by spaces.
+static char *rank(const EmojiTable *table, gint64 now) {
+  unsigned int *order = usage_log_rank(log_path, emoji_file, table, now);
+  if (order == NULL) {
+    return g_strdup("unchanged");
+  }
+
+  GString *out = g_string_new("");
+  for (unsigned int line = 0; line < table->len; ++line) {
+    g_string_append_printf(out, "%s%u", line > 0 ? " " : "", order[line]);
+  }
+  g_free(order);
+  return g_string_free(out, FALSE);
+}
+
+static goffset log_size(void) {
+  struct stat info;
+  ck_assert_int_eq(g_stat(log_path, &info), 0);
+  return info.st_size;
+}
+
+#define ck_assert_rank(table, now, expected)                                   \
+  do {                                                                         \
+    char *order = rank(table, now);                                            \
+    ck_assert_str_eq(order, expected);                                         \
+    g_free(order);                                                             \
+  } while (0)
+
+START_TEST(test_no_log) { ck_assert_rank(emojis, NOW, "unchanged"); }
+END_TEST
+
+START_TEST(test_most_used_first) {
+  use(emojis, 2, NOW - 60);
+  use(emojis, 2, NOW - 50);
+  use(emojis, 3, NOW - 40);
+  use(emojis, 2, NOW - 30);
+  use(emojis, 3, NOW - 20);
+  use(emojis, 1, NOW - 10);
+
+  ck_assert_rank(emojis, NOW, "2 3 1 0");
+}
+END_TEST
+
+START_TEST(test_recent_first) {
+  // Used a lot two months ago, but only once yesterday still counts for more.
+  for (int i = 0; i < 5; ++i) {
+    use(emojis, 0, NOW - 60 * DAY);
+  }
+  use(emojis, 3, NOW - DAY);
+  ck_assert_rank(emojis, NOW, "3 0 1 2");
+
+  // After a year, neither counts anymore.
+  ck_assert_rank(emojis, NOW + 365 * DAY, "unchanged");
+}
+END_TEST
+
+START_TEST(test_moved_emojis) {
+  use(emojis, 1, NOW);
+  use(emojis, 1, NOW);
+  use(emojis, 3, NOW);
+
+  // The emoji file changed: the unicorn moved, and the cat is gone.
+  EmojiTable *changed =
+      build_table((const char *[]){"🦄", "😀", "🐶", NULL});
+  goffset size = log_size();
+  ck_assert_rank(changed, NOW, "0 1 2");
+
+  // Where the unicorn is now was recorded, and the cat was forgotten.
+  ck_assert_int_lt(log_size(), size);
+  size = log_size();
+  ck_assert_rank(changed, NOW, "0 1 2");
+  ck_assert_int_eq(log_size(), size);
+  ck_assert_rank(emojis, NOW, "1 0 2 3");
+  emoji_table_free(changed);
+}
+END_TEST
+
+START_TEST(test_other_files) {
+  emoji_file = "/home/user/emojis.txt";
+  use(emojis, 3, NOW);
+  use(emojis, 3, NOW);
+  use(emojis, 2, NOW);
+
+  // The bundled emojis are listed as they are, and the uses of the other file
+  // are left alone.
+  emoji_file = NULL;
+  EmojiTable *bundled = build_table((const char *[]){"🐶", "😀", NULL});
+  ck_assert_rank(bundled, NOW, "unchanged");
+  use(bundled, 1, NOW);
+  ck_assert_rank(bundled, NOW, "1 0");
+
+  emoji_file = "/home/user/emojis.txt";
+  ck_assert_rank(emojis, NOW, "3 2 0 1");
+  emoji_table_free(bundled);
+}
+END_TEST
+
+START_TEST(test_compaction) {
+  // One more use each time, so that every emoji ends up counting for a
+  // different amount.
+  for (int i = 0; i < 3000; ++i) {
+    use(emojis, i % 10 < 5 ? 3 : i % 10 < 8 ? 0 : 1, NOW);
+  }
+
+  // Only a fraction of the uses is kept, without changing what they count for.
+  ck_assert_int_lt(log_size(), 3000 * 16);
+  ck_assert_rank(emojis, NOW, "3 0 1 2");
+}
+END_TEST
+
+START_TEST(test_broken_log) {
+  // Not a usage log at all.
+  char *log_dir = g_path_get_dirname(log_path);
+  g_mkdir_with_parents(log_dir, 0700);
+  g_file_set_contents(log_path, "not a usage log", -1, NULL);
+  ck_assert_rank(emojis, NOW, "unchanged");
+  use(emojis, 2, NOW);
+  ck_assert_rank(emojis, NOW, "2 0 1 3");
+
+  // A record that was only written in part.
+  use(emojis, 3, NOW);
+  use(emojis, 3, NOW);
+  goffset size = log_size();
+  ck_assert_int_eq(truncate(log_path, size - 3), 0);
+  ck_assert_rank(emojis, NOW, "2 3 0 1");
+  use(emojis, 1, NOW);
+  use(emojis, 1, NOW);
+  ck_assert_rank(emojis, NOW, "1 2 3 0");
+
+  g_free(log_dir);
+}
+END_TEST
+
+Suite *usage_suite(void) {
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Usage");
+  tc_core = tcase_create("Core");
+
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+
+  tcase_add_test(tc_core, test_no_log);
+  tcase_add_test(tc_core, test_most_used_first);
+  tcase_add_test(tc_core, test_recent_first);
+  tcase_add_test(tc_core, test_moved_emojis);
+  tcase_add_test(tc_core, test_other_files);
+  tcase_add_test(tc_core, test_compaction);
+  tcase_add_test(tc_core, test_broken_log);
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void) {
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = usage_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_VERBOSE);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -196,6 +196,20 @@ START_TEST(test_codepoint) {
 }
 END_TEST
 
+START_TEST(test_hash) {
+  // Reference values of FNV-1a; bytes of multi-byte characters are unsigned.
+  ck_assert_uint_eq(hash_string(""), 0x811c9dc5u);
+  ck_assert_uint_eq(hash_string("a"), 0xe40c292cu);
+  ck_assert_uint_eq(hash_string("🙃"), 0x56a378b8u);
+
+  // Less than eight bytes are hashed one at a time, like 64-bit FNV-1a.
+  ck_assert_uint_eq(hash_data("a", 1), 0xaf63dc4c8601ec8cu);
+  ck_assert_uint_eq(hash_data("🙃", 4), 0xff026a387504e098u);
+  ck_assert_uint_ne(hash_data("12345678a", 9), hash_data("12345678b", 9));
+  ck_assert_uint_ne(hash_data("12345678", 8), hash_data("12345679", 8));
+}
+END_TEST
+
 Suite *utils_suite(void) {
   Suite *s;
   TCase *tc_core;
@@ -206,6 +220,7 @@ Suite *utils_suite(void) {
 
   tc_core = tcase_create("Core");
   tcase_add_test(tc_core, test_capitalize);
+  tcase_add_test(tc_core, test_hash);
 
   tc_tokenize = tcase_create("Tokenize");
   tcase_add_test(tc_tokenize, test_tokenize_search_simple_query);